@@ -11,6 +11,7 @@
 
 // EXTRA CREDIT FEATURES: EC1, EC2, EC3, EC4 implemented
 
+#define _GNU_SOURCE // pipe2()
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,8 +22,33 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <time.h>
+#include <ctype.h>
+#include <glob.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <poll.h>
 #include "mash.h"
 #include "masherror.h"
+#include "mashtrace.h"
+#include "mashhistory.h"
+#include "mashremote.h"
+#include "mashboard.h"
+#include "mashcompare.h"
+#include "mashindex.h"
+
+// options given on command line, see OptionParser()
+MashOptions options;
+
+// execution backends, see ExecBackend
+ExecBackend localBackend = {"local", LocalLaunch};
+ExecBackend remoteBackend = {"remote", RemoteLaunch};
+
+// run to tear down on interrupt, see InterruptHandler()
+int mainPID;
+JobMatrix* interruptMatrix = nullptr;   // set while cache files of matrix exist
+int* interruptReaped = nullptr;         // set while Scheduler() runs jobs of matrix
 
 /**
  * @brief MsgCollector
@@ -102,6 +128,159 @@ STATUS MessageParser(IN int* message, IN int* numberOfEntries, OUT char*** comma
     return 0;
 }
 
+/**
+ * @brief OptionParser
+ * 
+ * @param argc: argument count
+ * @param argv: argument list
+ * 
+ * The function will parse command line options of mash into global options.
+ *   -j N: run at most N job processes at the same time (default: number of online cores, at least 3).
+ *   -t file: record lifecycle events of mash and dump them to file as Chrome trace JSON.
+ *   -m mode: 'all' runs every job (default), 'race' stops remaining jobs once a job succeeds,
+ *            'failfast' stops remaining jobs once a job fails.
+ *   -H file: runtime history used to schedule longest-expected-first, e.g. ~/.mash_history
+ *            (default: off, jobs keep input order and nothing is recorded).
+ *   -r host:port,...: ship jobs to mash agents instead of running them on this host.
+ *   -a [address:]port: run as an agent serving remote jobs on port of address, loopback by default.
+ *   -p: show live progress of running jobs on stderr.
+ *   -c: compare output of commands on each target file.
+ *   -i lines|off: lines per block of sidecar index used by mgrep, 'off' to scan without it.
+ */
+STATUS OptionParser(IN int argc, IN char* argv[]) {
+    // at least one slot per command, so three commands still run concurrently by default
+    options.maxJobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (options.maxJobs < NUM_OF_JOBS) {
+        options.maxJobs = NUM_OF_JOBS;
+    }
+    options.traceFile = nullptr;
+    options.policy = POLICY_ALL;
+    options.historyFile = nullptr;
+    options.backend = &localBackend;
+    options.agents = nullptr;
+    options.numberOfAgents = 0;
+    options.agentPort = 0;
+    options.agentAddress = nullptr;
+    options.progress = false;
+    options.compare = false;
+    options.indexLines = INDEX_BLOCK_LINES;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:t:m:H:r:a:pci:")) != -1) {
+        switch (opt) {
+        case 'j':
+            options.maxJobs = atoi(optarg);
+            break;
+        case 't':
+            options.traceFile = optarg;
+            break;
+        case 'm':
+            if (strcmp(optarg, "race") == 0) {
+                options.policy = POLICY_RACE;
+            }
+            else if (strcmp(optarg, "failfast") == 0) {
+                options.policy = POLICY_FAIL_FAST;
+            }
+            else if (strcmp(optarg, "all") != 0) {
+                fprintf(stderr, "Error: unknown mode '%s', expect all, race or failfast.\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'H':
+            options.historyFile = (strcmp(optarg, "off") == 0) ? nullptr : optarg;
+            break;
+        case 'r':
+            options.backend = &remoteBackend;
+            options.agents = malloc(sizeof(char*) * (strlen(optarg) / 2 + 1));
+            for (char* token = strtok(optarg, ","); token != nullptr; token = strtok(nullptr, ",")) {
+                options.agents[options.numberOfAgents++] = token;
+            }
+            if (options.numberOfAgents == 0) {
+                options.backend = &localBackend;
+            }
+            break;
+        case 'a':
+            // [address:]port, agent binds loopback only unless an address is given
+            if (strrchr(optarg, ':') != nullptr) {
+                options.agentAddress = optarg;
+                *strrchr(optarg, ':') = '\0';
+                optarg += strlen(optarg) + 1;
+            }
+            options.agentPort = atoi(optarg);
+            break;
+        case 'p':
+            options.progress = true;
+            break;
+        case 'c':
+            options.compare = true;
+            break;
+        case 'i':
+            options.indexLines = (strcmp(optarg, "off") == 0) ? 0 : atoi(optarg);
+            if (options.indexLines < 0) {
+                options.indexLines = INDEX_BLOCK_LINES;
+            }
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-j jobs] [-t trace.json] [-m all|race|failfast] [-H history] "
+                            "[-r host:port,...] [-a [address:]port] [-p] [-c] [-i lines|off]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (options.maxJobs < 1) {
+        options.maxJobs = 1;
+    }
+    if (((options.backend == &remoteBackend) || (options.agentPort > 0)) && (remote_token() == nullptr)) {
+        fprintf(stderr, "Error: remote jobs need a shared token in $%s.\n", REMOTE_TOKEN_ENV);
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief TargetExpander
+ * 
+ * @param file: raw file field, a list of files or glob patterns separated by spaces
+ * @param files_out: expanded file names
+ * @param size_o: size of files_out
+ * 
+ * The function will expand every pattern in file field with glob(). A pattern matching nothing
+ * is kept as it is, so that job reports the missing file by itself.
+ */
+STATUS TargetExpander(IN const char* file, OUT char*** files_out, OUT int* size_o) {
+    char* newFile = strdup(file);
+    glob_t globbuf;
+    int flags = GLOB_NOCHECK | GLOB_TILDE;
+    int size = 0;
+    
+    char* token = strtok(newFile, FILE_DELIMITER);
+    while (token != nullptr) {
+        if (glob(token, flags, nullptr, &globbuf) == 0) {
+            flags |= GLOB_APPEND;
+        }
+        token = strtok(nullptr, FILE_DELIMITER);
+    }
+
+    char** fileList = nullptr;
+    if (flags & GLOB_APPEND) {
+        size = globbuf.gl_pathc;
+        fileList = malloc(sizeof(char*) * size);
+        for (int i = 0; i < size; i++) {
+            fileList[i] = strdup(globbuf.gl_pathv[i]);
+        }
+        globfree(&globbuf);
+    }
+    free(newFile);
+
+    if (DEBUG) {
+        printf("Main Process: %d target files expanded from '%s'\n", size, file);
+    }
+
+    *files_out = fileList;
+    *size_o = size;
+
+    return 0;
+}
+
 /**
  * @brief WaitStatusChecker
  * 
@@ -233,16 +412,33 @@ int isCommandWithTarget(const char* command) {
  * 
  * @param processID 
  * @param statusCode
+ * @param record: status record of the process, pid is 0 if it sent none
  * 
- * The function will print child process information according to status.
+ * The function will print child process information according to status. For a command which
+ * ran but failed, its real exit status or signal is shown instead of MASH status code.
  */
-void printChildrenProcess(int processID, int statusCode) {
+void printChildrenProcess(int processID, int statusCode, JobStatus* record) {
     if (statusCode == 0) {
         printf("%s%d(%d) %s", KGRN, processID, statusCode, RESET);
     }
     else if (statusCode == PROCESS_NO_COMMAND_WARNING) {
         printf("%s%d(%d) %s", KBLU, processID, statusCode, RESET);
     }
+    else if ((statusCode == PROCESS_CANCELLED_WARNING) && (processID == 0)) {
+        printf("%s-(%d) %s", KYEL, statusCode, RESET); // never dispatched
+    }
+    else if (statusCode == PROCESS_CANCELLED_WARNING) {
+        printf("%s%d(%d) %s", KYEL, processID, statusCode, RESET);
+    }
+    else if ((statusCode == PROCESS_COMMAND_STATUS_ERROR) && (record->pid != 0) && (record->signal != 0)) {
+        printf("%s%d(signal %d) %s", KRED, processID, record->signal, RESET);
+    }
+    else if ((statusCode == PROCESS_COMMAND_STATUS_ERROR) && (record->pid != 0)) {
+        printf("%s%d(exit %d) %s", KRED, processID, WEXITSTATUS(record->waitStatus), RESET);
+    }
+    else if ((statusCode == PROCESS_EXECVP_ERROR) && (record->pid != 0)) {
+        printf("%s%d(%d: %s) %s", KRED, processID, statusCode, strerror(record->execErrno), RESET);
+    }
     else {
         printf("%s%d(%d) %s", KRED, processID, statusCode, RESET);
     }
@@ -267,10 +463,182 @@ STATUS Worker(IN const char* command, IN const char* file, IN int order) {
     int size; 
 
     // TODO: redirect stdout and stderr to cache
+    CacheRedirect();
+
+    if (strlen(command) == 0) {
+        process_no_command_warning(order); // print header by itself
+    }
+
+    // TODO: parse command string
+    CommandParser(command, file, &args, &size);
+    
+    // TODO: print head summary
+    int headerSize;
+    if (strlen(file) == 0) {
+        headerSize = printf("-----CMD %d: %s", order, command);
+    }
+    else {
+        headerSize = printf("-----CMD %d: %s [%s]", order, command, file);
+    }
+    int paddingSize = SIZE_OF_DELIMITER_LINE - headerSize;
+    for (int i = 0; i < paddingSize; i++) {
+        printf("-");
+    }
+    printf("\n");
+    fflush(stdout);
+
+    // TODO: check valid of command and arguments
+    if ((strlen(file) == 0) && (isCommandWithTarget(args[0]) && (access(args[size-1], F_OK) != 0))) {
+        // if target file is not found in file or the last argument, then PROCESS_COMMAND_ERROR
+        process_command_exception(args[0]);
+    }
+
+    // TODO: create a new process to execute command
+    args[size++] = nullptr; // add nullptr for execvp()
+    int output[2]; // output of command is relayed to cache through pipe, 0 for read, 1 for write
+    int execError[2]; // errno of failed execvp(), closed without data on success
+    if ((pipe(output) == -1) || (pipe2(execError, O_CLOEXEC) == -1)) {
+        process_pipe_exception();
+    }
+    JobStatus* record = status_channel_record();
+    struct timeval start_t, end_t;
+    gettimeofday(&start_t, 0x0);
+    record->startTime = start_t.tv_sec * 1000000L + start_t.tv_usec;
+    long forkStart = trace_now();
+
+    int execPID = fork();
+    if (execPID == -1) {
+        process_allocation_exception();
+    }
+    if (execPID == 0) {
+        close(output[0]);
+        close(execError[0]);
+        dup2(output[1], STDOUT_FILENO);
+        dup2(output[1], STDERR_FILENO);
+        close(output[1]);
+        if (strcmp(args[0], INDEX_GREP) == 0) {
+            // built-in grep runs in place of exec, over sidecar index of target file
+            close(execError[1]); // nothing closes it on exec, job process waits for its end
+            int status = index_grep(size - 1, args, options.indexLines);
+            fflush(stdout);
+            _exit(status);
+        }
+        execvp(args[0], args);
+        int execErrno = errno;
+        write(execError[1], &execErrno, sizeof(execErrno));
+        _exit(EXIT_FAILURE);
+    }
+
+    // TODO: learn whether command is executed at all
+    JobSlot* slot = status_channel_slot();
+    if (slot != nullptr) {
+        slot->execPid = execPID;
+        board_set_state(slot, SLOT_RUNNING);
+    }
+    close(output[1]);
+    close(execError[1]);
+    int execErrno = 0;
+    if (read(execError[0], &execErrno, sizeof(execErrno)) != sizeof(execErrno)) {
+        execErrno = 0;
+    }
+    close(execError[0]);
+    trace_span("fork/exec", command, forkStart); // errno pipe is closed by a successful exec
+
+    // TODO: relay output of command to cache until command closes its end of pipe
+    char buffer[RELAY_BUFFER_SIZE];
+    long bytes = 0;
+    ssize_t n;
+    while (((n = read(output[0], buffer, sizeof(buffer))) > 0) || ((n == -1) && (errno == EINTR))) {
+        if (n == -1) {
+            continue;
+        }
+        if (bytes == 0) {
+            trace_instant("first output byte", command);
+        }
+        if (CacheWrite(buffer, n) == -1) {
+            // output can not be kept, stop command rather than report a truncated cache
+            kill(execPID, SIGKILL);
+            waitpid(execPID, nullptr, 0);
+            process_cache_exception();
+        }
+        board_progress(slot, buffer, n);
+        bytes += n;
+    }
+    close(output[0]);
+
+    // TODO: catch exit status of child process
+    int execWstatus;
+    int execRes = waitpid(execPID, &execWstatus, 0);
+    if (execRes == -1) {
+        process_wait_exception(args[0]);
+    }
+    trace_span("exec", command, forkStart);
+
+    gettimeofday(&end_t, 0x0);
+    record->endTime = end_t.tv_sec * 1000000L + end_t.tv_usec;
+    record->execErrno = execErrno;
+    record->waitStatus = execWstatus;
+    record->signal = WIFSIGNALED(execWstatus) ? WTERMSIG(execWstatus) : 0;
+    record->bytes = bytes;
+    record->lines = (slot != nullptr) ? slot->lines : 0;
+    double runtime = (double)(record->endTime - record->startTime) / 1000;
+
+    if (DEBUG) {
+        printf("Received wait status: %d, exec errno: %d\n", execWstatus, execErrno);
+    }
+    if (execErrno != 0) {
+        process_execvp_exception(args[0]);
+    }
+    if (!WIFEXITED(execWstatus) || (WEXITSTATUS(execWstatus) != 0)) {
+        process_command_status_exception(args[0], execWstatus);
+    }
+    // TODO: output command summary to cachefile -- summary
+    printf("%s[Success]: result took: %.0fms%s\n", KGRN, runtime, RESET);
+    fflush(stdout);
+    status_channel_emit(0);
+
+    // TODO: free dynamic memory
+    if (args != nullptr) {
+        free(args);
+    }
+
+    return 0; 
+}
+
+/**
+ * @brief CacheWrite
+ * 
+ * @param buffer: output to append to cache
+ * @param size: size of output
+ * @return int: 0 if every byte is written, -1 otherwise, e.g. ENOSPC
+ * 
+ * The function will write output relayed by job process to its cache on stdout.
+ */
+int CacheWrite(const char* buffer, long size) {
+    while (size > 0) {
+        ssize_t n = write(STDOUT_FILENO, buffer, size);
+        if ((n == -1) && (errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buffer += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief CacheRedirect
+ * 
+ * The function will redirect stdout and stderr of job process to cache 'job_{pid}_cache'.
+ */
+void CacheRedirect() {
     if (!DEBUG) {
         char cacheName[CACHE_NAME_SIZE];
         sprintf(cacheName, "job_%d_cache", getpid());
-        int descriptor = open(cacheName, O_WRONLY | O_CREAT, 0644);
+        int descriptor = open(cacheName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
         if (descriptor == -1) {
             printf("Error: failed to create a file.\n");
             exit(279);
@@ -279,95 +647,1031 @@ STATUS Worker(IN const char* command, IN const char* file, IN int order) {
         dup2(descriptor, STDERR_FILENO);
         close(descriptor);
     }
+}
 
-    if (strlen(command) == 0) {
-        process_no_command_warning(order); // print header by itself
+/**
+ * @brief JobFile
+ * 
+ * @return const char*: target file of job, empty string if file field is blank
+ */
+const char* JobFile(JobMatrix* matrix, int job) {
+    if (matrix->numberOfFiles == 0) {
+        return "";
     }
+    return matrix->files[job % matrix->filesPerCommand];
+}
 
-    // TODO: parse command string
-    CommandParser(command, file, &args, &size);
-    
-    // TODO: print head summary
-    int printPID = fork();
-    if (printPID == -1) {
+/**
+ * @brief LocalLaunch
+ * 
+ * @param matrix: job matrix
+ * @param job: index of job to launch
+ * @return int: process id of job process
+ * 
+ * Local backend: the job process runs Worker(), which fork/exec the command on this host.
+ */
+int LocalLaunch(JobMatrix* matrix, int job) {
+    int command = job / matrix->filesPerCommand;
+    int jobPID = fork();
+    if (jobPID == -1) {
         process_allocation_exception();
-    }    
-    if (printPID == 0) {
-        printf("-----CMD %d: %s", order, command);
-        int paddingSize = SIZE_OF_DELIMITER_LINE - 12 - strlen(command);
-        for (int i = 0; i < paddingSize; i++) {
-            printf("-");
+    }
+    if (jobPID == 0) {
+        // TODO: Job Process
+        if (options.policy != POLICY_ALL) {
+            setpgid(0, 0); // own process group, so job can be killed with its command
         }
-        printf("\n");
+        sigset_t childSignal;
+        sigemptyset(&childSignal);
+        sigaddset(&childSignal, SIGCHLD);
+        sigaddset(&childSignal, SIGINT);
+        sigaddset(&childSignal, SIGTERM);
+        sigaddset(&childSignal, SIGHUP);
+        sigprocmask(SIG_UNBLOCK, &childSignal, nullptr);
+        status_channel_open(&matrix->board[job], job);
+        Worker(matrix->commands[command], JobFile(matrix, job), command + 1);
+        exit(0);
     }
-    else {
-        int print_res = wait(nullptr);
-        if (print_res == -1) {
-            process_wait_exception();
+    return jobPID;
+}
+
+/**
+ * @brief RemoteLaunch
+ * 
+ * @param matrix: job matrix
+ * @param job: index of job to launch
+ * @return int: process id of job process
+ * 
+ * Remote backend: the job process runs RemoteWorker(), which ships the job to an agent. Jobs are
+ * spread over agents in round robin.
+ */
+int RemoteLaunch(JobMatrix* matrix, int job) {
+    int command = job / matrix->filesPerCommand;
+    int jobPID = fork();
+    if (jobPID == -1) {
+        process_allocation_exception();
+    }
+    if (jobPID == 0) {
+        // TODO: Job Process
+        if (options.policy != POLICY_ALL) {
+            setpgid(0, 0);
+        }
+        sigset_t childSignal;
+        sigemptyset(&childSignal);
+        sigaddset(&childSignal, SIGCHLD);
+        sigaddset(&childSignal, SIGINT);
+        sigaddset(&childSignal, SIGTERM);
+        sigaddset(&childSignal, SIGHUP);
+        sigprocmask(SIG_UNBLOCK, &childSignal, nullptr);
+        status_channel_open(&matrix->board[job], job);
+        RemoteWorker(matrix->commands[command], JobFile(matrix, job), command + 1, job % options.numberOfAgents);
+        exit(0);
+    }
+    return jobPID;
+}
+
+/**
+ * @brief RemoteWorker
+ * 
+ * @param command: raw command string received from main process
+ * @param file: target file, empty if blank
+ * @param order: order of command
+ * @param firstAgent: agent to try first
+ * 
+ * The function will ship a job descriptor {token, request, command, file, order, force} to an agent and relay
+ * the output of the job into the local cache, so Reporter() merges it as a local job. An agent
+ * without the target file declines the job and the next agent is tried; the last agent is
+ * forced to run it and report the missing file. Status record of the remote job is routed back
+ * into status channel of this process.
+ */
+STATUS RemoteWorker(IN const char* command, IN const char* file, IN int order, IN int firstAgent) {
+    CacheRedirect();
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int k = 0; k < options.numberOfAgents; k++) {
+        const char* agent = options.agents[(firstAgent + k) % options.numberOfAgents];
+        int force = (k == options.numberOfAgents - 1);
+        int fd = remote_connect(agent);
+        if (fd == -1) {
+            continue;
+        }
+        int accepted = 0;
+        if ((remote_send_string(fd, remote_token()) == -1) || (remote_send_int(fd, REMOTE_REQUEST_JOB) == -1) ||
+            (remote_send_string(fd, command) == -1) || (remote_send_string(fd, file) == -1) || 
+            (remote_send_int(fd, order) == -1) || (remote_send_int(fd, force) == -1) ||
+            (remote_recv_int(fd, &accepted) == -1) || !accepted) {
+            close(fd);
+            continue;
         }
 
-        // TODO: check valid of command and arguments
-        if ((strlen(file) == 0) && (isCommandWithTarget(args[0]) && (access(args[size-1], F_OK) != 0))) {
-            // if target file is not found in file or the last argument, then PROCESS_COMMAND_ERROR
-            process_command_exception(args[0]);
+        // TODO: relay output frames {len, bytes} until an empty frame, then status record
+        board_set_state(status_channel_slot(), SLOT_RUNNING);
+        char buffer[RELAY_BUFFER_SIZE];
+        int len = -1; // stays -1 if agent is gone before first frame
+        while ((remote_recv_int(fd, &len) == 0) && (len > 0) && (len <= RELAY_BUFFER_SIZE)) {
+            if (remote_recv(fd, buffer, len) == -1) {
+                break;
+            }
+            if (CacheWrite(buffer, len) == -1) {
+                close(fd); // agent kills the job once connection is gone
+                process_cache_exception();
+            }
+        }
+        JobStatus* record = status_channel_record();
+        if ((len != 0) || (remote_recv_status(fd, record) == -1)) {
+            close(fd);
+            process_remote_exception(agent);
         }
+        close(fd);
+        JobSlot* slot = status_channel_slot();
+        if (slot != nullptr) {
+            // frames carry the whole remote cache, take output volume of command from its record
+            slot->bytes = record->bytes;
+            slot->lines = record->lines;
+            slot->lastActivity = board_now();
+        }
+        printf("%s[Remote]: ran on agent %s%s\n", KBLU, agent, RESET);
+        status_channel_emit(record->mashCode);
+        exit(record->mashCode);
+    }
 
-        // TODO: create a new process to execute command
-        args[size++] = nullptr; // add nullptr for execvp()
-        struct timeval start_t, end_t;
-        gettimeofday(&start_t, 0x0);
+    process_remote_exception(options.agents[firstAgent]);
+    return 0;
+}
 
-        int execPID = fork();
-        if (execPID == -1) {
+/**
+ * @brief FileListAppend
+ * 
+ * @param list: growing list of file names
+ * @param size: number of names in list
+ * @param capacity: number of names list has room for
+ * @param file: name to append, owned by list from now on
+ */
+void FileListAppend(char*** list, int* size, int* capacity, char* file) {
+    if (*size == *capacity) {
+        *capacity = (*capacity == 0) ? 16 : *capacity * 2;
+        *list = realloc(*list, sizeof(char*) * (*capacity));
+        if (*list == nullptr) {
             process_allocation_exception();
         }
-        if (execPID == 0) {
-            int status = execvp(args[0], args);
-            exit(status);
-        }
-        else {
-            // TODO: catch exit status of child process
-            int execWstatus;
-            int execRes = waitpid(execPID, &execWstatus, 0);
-            if (execRes == -1) {
-                process_wait_exception(args[0]);
-            }
-
-            gettimeofday(&end_t, 0x0);
-            // runtime_t in microseconds
-            int runtime_t = (end_t.tv_sec - start_t.tv_sec) * 1000000 + (end_t.tv_usec - start_t.tv_usec);
-            double runtime = (double)runtime_t / 1000;
-
-            if (WIFEXITED(execWstatus)) {
-                // @statusCode: indicate process status: 
-                //      0 for normal exit, 255 and 2 for invalid use of command
-                int statusCode = WEXITSTATUS(execWstatus);
-                if (DEBUG) {
-                    printf("Received status code: %d\n", statusCode);
+    }
+    (*list)[(*size)++] = file;
+}
+
+/**
+ * @brief RemoteExpander
+ * 
+ * @param file: raw file field, a list of files or glob patterns separated by spaces
+ * @param files_out: expanded file names
+ * @param size_o: size of files_out
+ * 
+ * The function will expand file field like TargetExpander(), but on agents, where the files are:
+ * every glob pattern is sent to every agent and files matched on any of them are merged, each
+ * once, so one pattern lists shards spread over nodes. A pattern matching nothing on reachable
+ * agents is kept as it is, so that job reports the missing file by itself.
+ */
+STATUS RemoteExpander(IN const char* file, OUT char*** files_out, OUT int* size_o) {
+    void (*pipeHandler)(int) = signal(SIGPIPE, SIG_IGN); // not inherited by jobs
+    char* newFile = strdup(file);
+    char** fileList = nullptr;
+    int size = 0;
+    int capacity = 0;
+
+    char* next;
+    char* token = strtok_r(newFile, FILE_DELIMITER, &next);
+    while (token != nullptr) {
+        int first = size;
+        for (int k = 0; (strpbrk(token, "*?[") != nullptr) && (k < options.numberOfAgents); k++) {
+            int fd = remote_connect(options.agents[k]);
+            if (fd == -1) {
+                continue;
+            }
+            int count = 0;
+            if ((remote_send_string(fd, remote_token()) == -1) || (remote_send_int(fd, REMOTE_REQUEST_EXPAND) == -1) ||
+                (remote_send_string(fd, token) == -1) || (remote_recv_int(fd, &count) == -1)) {
+                count = 0;
+            }
+            for (int i = 0; i < count; i++) {
+                char* path;
+                if (remote_recv_string(fd, &path) == -1) {
+                    break;
                 }
-                if (statusCode == 255) {
-                    process_execvp_exception(args[0]);
-                } 
-                else if (statusCode == 1) {
-                    process_file_directory_exception();
+                int seen = false;
+                for (int j = first; (j < size) && !seen; j++) {
+                    seen = (strcmp(fileList[j], path) == 0);
                 }
-                else if (statusCode == 2) {
-                    process_command_usage_exception(args[0]);
+                if (seen) {
+                    free(path);
+                    continue;
+                }
+                FileListAppend(&fileList, &size, &capacity, path);
+            }
+            close(fd);
+        }
+        if (size == first) {
+            FileListAppend(&fileList, &size, &capacity, strdup(token));
+        }
+        token = strtok_r(nullptr, FILE_DELIMITER, &next);
+    }
+    free(newFile);
+    signal(SIGPIPE, pipeHandler);
+
+    if (DEBUG) {
+        printf("Main Process: %d target files expanded on agents from '%s'\n", size, file);
+    }
+
+    *files_out = fileList;
+    *size_o = size;
+
+    return 0;
+}
+
+/**
+ * @brief AgentExpand
+ * 
+ * @param fd: connection from a remote client
+ * 
+ * The function will expand a glob pattern received from client in working directory of agent,
+ * and send back {count, paths...} of the files it matches.
+ */
+STATUS AgentExpand(IN int fd) {
+    char* pattern;
+    if (remote_recv_string(fd, &pattern) == -1) {
+        exit(PROCESS_REMOTE_ERROR);
+    }
+    glob_t globbuf;
+    int count = 0;
+    if (glob(pattern, GLOB_TILDE, nullptr, &globbuf) == 0) {
+        count = globbuf.gl_pathc;
+    }
+    if (remote_send_int(fd, count) == 0) {
+        for (int i = 0; i < count; i++) {
+            if (remote_send_string(fd, globbuf.gl_pathv[i]) == -1) {
+                break;
+            }
+        }
+    }
+    globfree(&globbuf);
+    free(pattern);
+    close(fd);
+
+    return 0;
+}
+
+/**
+ * @brief AgentSession
+ * 
+ * @param fd: connection from a remote worker
+ * 
+ * The function will run one job for a remote worker: read job descriptor, run it with Worker()
+ * into a local cache, then send cache back in frames followed by status record. The job is killed
+ * if the remote worker goes away before it is done, e.g. cancelled by short-circuit policy.
+ */
+STATUS AgentSession(IN int fd) {
+    char* token;
+    char* command;
+    char* file;
+    int order;
+    int force;
+    // a peer without the shared token is dropped before anything else is read
+    if ((remote_recv_string(fd, &token) == -1) || !remote_token_equal(remote_token(), token)) {
+        exit(PROCESS_REMOTE_ERROR);
+    }
+    free(token);
+    int request;
+    if (remote_recv_int(fd, &request) == -1) {
+        exit(PROCESS_REMOTE_ERROR);
+    }
+    if (request == REMOTE_REQUEST_EXPAND) {
+        AgentExpand(fd);
+        exit(0);
+    }
+    if ((request != REMOTE_REQUEST_JOB) || 
+        (remote_recv_string(fd, &command) == -1) || (remote_recv_string(fd, &file) == -1) ||
+        (remote_recv_int(fd, &order) == -1) || (remote_recv_int(fd, &force) == -1)) {
+        exit(PROCESS_REMOTE_ERROR);
+    }
+    int accepted = force || (strlen(file) == 0) || (access(file, R_OK) == 0);
+    if ((remote_send_int(fd, accepted) == -1) || !accepted) {
+        exit(0);
+    }
+
+    JobSlot* board = board_create(1);
+    if (board == nullptr) {
+        process_allocation_exception();
+    }
+    int jobPID = fork();
+    if (jobPID == -1) {
+        process_allocation_exception();
+    }
+    if (jobPID == 0) {
+        close(fd);
+        setpgid(0, 0);
+        status_channel_open(&board[0], -1);
+        Worker(command, file, order);
+        exit(0);
+    }
+    setpgid(jobPID, jobPID);
+
+    // TODO: wait job while watching connection, remote worker never writes after descriptor
+    // pidfd wakes poll() when job exits, without it fall back to polling every interval
+    int wstatus;
+    struct pollfd watch[2] = {{fd, POLLIN, 0}, {syscall(SYS_pidfd_open, jobPID, 0), POLLIN, 0}};
+    int numberOfWatches = (watch[1].fd == -1) ? 1 : 2;
+    while (waitpid(jobPID, &wstatus, WNOHANG) == 0) {
+        if ((poll(watch, numberOfWatches, REMOTE_POLL_INTERVAL) > 0) && (watch[0].revents != 0)) {
+            kill(-jobPID, SIGTERM);
+            waitpid(jobPID, &wstatus, 0);
+            break;
+        }
+    }
+    if (numberOfWatches == 2) {
+        close(watch[1].fd);
+    }
+    JobStatus record = board[0].status;
+    if (board_state(&board[0]) != SLOT_DONE) {
+        // job did not report, e.g. killed
+        memset(&record, 0, sizeof(record));
+        record.waitStatus = -1;
+        record.mashCode = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : PROCESS_CANCELLED_WARNING;
+    }
+    board_destroy(board, 1);
+
+    // TODO: send cache back and remove it
+    char cacheName[CACHE_NAME_SIZE];
+    sprintf(cacheName, "job_%d_cache", jobPID);
+    int cache = open(cacheName, O_RDONLY);
+    if (cache != -1) {
+        char buffer[RELAY_BUFFER_SIZE];
+        ssize_t n;
+        while ((n = read(cache, buffer, sizeof(buffer))) > 0) {
+            if ((remote_send_int(fd, n) == -1) || (remote_send(fd, buffer, n) == -1)) {
+                break;
+            }
+        }
+        close(cache);
+        unlink(cacheName);
+    }
+    remote_send_int(fd, 0);
+    remote_send_status(fd, &record);
+    close(fd);
+
+    return 0;
+}
+
+/**
+ * @brief Agent
+ * 
+ * @param port: TCP port to listen on, of options.agentAddress or loopback
+ * 
+ * The function will serve remote workers forever, one session process per connection. Only
+ * peers presenting the token of $MASH_TOKEN are served.
+ */
+STATUS Agent(IN int port) {
+    const char* address = (options.agentAddress == nullptr) ? "127.0.0.1" : options.agentAddress;
+    int listenFd = remote_listen(options.agentAddress, port);
+    if (listenFd == -1) {
+        printf("Error: failed to listen on %s:%d.\n", address, port);
+        exit(PROCESS_REMOTE_ERROR);
+    }
+    printf("mash agent [pid: %d] is listening on %s:%d...\n", getpid(), address, port);
+    fflush(stdout);
+    signal(SIGCHLD, SIG_IGN); // sessions are never waited
+    signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd == -1) {
+            continue;
+        }
+        int sessionPID = fork();
+        if (sessionPID == -1) {
+            close(fd);
+            continue;
+        }
+        if (sessionPID == 0) {
+            close(listenFd);
+            signal(SIGCHLD, SIG_DFL);
+            AgentSession(fd);
+            exit(0);
+        }
+        close(fd);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief InterruptHandler
+ * 
+ * @param sig: SIGINT, SIGTERM or SIGHUP
+ * 
+ * The function will terminate every job not reaped yet together with its command, wait for them
+ * and remove cache files, then let main process die of the signal. Under a short-circuit policy,
+ * jobs are in their own process groups and would be orphaned otherwise. Only async-signal-safe
+ * functions are called.
+ */
+void InterruptHandler(int sig) {
+    if ((getpid() == mainPID) && (interruptMatrix != nullptr)) {
+        JobMatrix* matrix = interruptMatrix;
+        for (int i = 0; (interruptReaped != nullptr) && (i < matrix->numberOfJobs); i++) {
+            int pid = matrix->jobQueue[i];
+            if ((pid != 0) && !interruptReaped[i]) {
+                if (options.policy != POLICY_ALL) {
+                    kill(-pid, SIGTERM);
                 }
                 else {
-                    // TODO: output command summary to cachefile -- summary
-                    printf("%s[Success]: result took: %.0fms%s\n", KGRN, runtime, RESET);
+                    if (matrix->board[i].execPid > 0) {
+                        kill(matrix->board[i].execPid, SIGTERM);
+                    }
+                    kill(pid, SIGTERM);
+                }
+            }
+        }
+        for (int i = 0; (interruptReaped != nullptr) && (i < matrix->numberOfJobs); i++) {
+            if ((matrix->jobQueue[i] != 0) && !interruptReaped[i]) {
+                waitpid(matrix->jobQueue[i], nullptr, 0);
+            }
+        }
+        for (int i = 0; i < matrix->numberOfJobs; i++) {
+            if (matrix->jobQueue[i] == 0) {
+                continue;
+            }
+            // sprintf() is not async-signal-safe, spell out "job_<pid>_cache"
+            char cacheName[CACHE_NAME_SIZE] = "job_";
+            char digits[CACHE_NAME_SIZE];
+            int size = strlen(cacheName);
+            int n = 0;
+            for (int pid = matrix->jobQueue[i]; pid > 0; pid /= 10) {
+                digits[n++] = '0' + (pid % 10);
+            }
+            while (n > 0) {
+                cacheName[size++] = digits[--n];
+            }
+            strcpy(cacheName + size, "_cache");
+            unlink(cacheName);
+        }
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/**
+ * @brief Scheduler
+ * 
+ * @param matrix: job matrix to run
+ * 
+ * The function will run every job of matrix on a pool of at most options.maxJobs job processes.
+ * A new job is dispatched as soon as a running one is finished. Under a short-circuit policy,
+ * every job runs in its own process group and the first deciding job kills all the others.
+ */
+STATUS Scheduler(IN JobMatrix* matrix) {
+    int next = 0;       // next job to dispatch, index into plan
+    int running = 0;    // number of job processes alive
+    int wstatus;
+    int res;
+    long* launched = calloc(matrix->numberOfJobs, sizeof(long)); // trace time of dispatch
+    struct timeval* started = calloc(matrix->numberOfJobs, sizeof(struct timeval));
+    int* plan = malloc(sizeof(int) * matrix->numberOfJobs); // jobs in dispatch order
+    int* reaped = calloc(matrix->numberOfJobs, sizeof(int)); // process group id may be reused once reaped
+
+    History* history = nullptr;
+    if (options.historyFile != nullptr) {
+        history = malloc(sizeof(History));
+        history_load(history, options.historyFile);
+    }
+    DispatchPlanner(matrix, history, plan);
+
+    // SIGCHLD is blocked so ProgressWait() can sleep on it, job processes unblock it
+    Progress progress = {board_now(), 0, 0, isatty(STDERR_FILENO)};
+    sigset_t childSignal;
+    sigset_t oldMask;
+    sigemptyset(&childSignal);
+    sigaddset(&childSignal, SIGCHLD);
+    if (options.progress) {
+        sigprocmask(SIG_BLOCK, &childSignal, &oldMask);
+    }
+
+    // interrupt signals are blocked while a job is dispatched, so InterruptHandler() sees its pid
+    sigset_t interruptSignal;
+    sigemptyset(&interruptSignal);
+    sigaddset(&interruptSignal, SIGINT);
+    sigaddset(&interruptSignal, SIGTERM);
+    sigaddset(&interruptSignal, SIGHUP);
+    interruptReaped = reaped;
+
+    while ((next < matrix->numberOfJobs) || (running > 0)) {
+        // TODO: fill the pool
+        while ((next < matrix->numberOfJobs) && (running < options.maxJobs)) {
+            int job = plan[next];
+            int command = job / matrix->filesPerCommand;
+            sigprocmask(SIG_BLOCK, &interruptSignal, nullptr);
+
+            fflush(stdout); // do not leak buffered output into cache of job
+            launched[job] = trace_now();
+            gettimeofday(&started[job], 0x0);
+            int jobPID = options.backend->launch(matrix, job);
+            if (options.policy != POLICY_ALL) {
+                setpgid(jobPID, jobPID); // avoid racing with child
+            }
+            trace_span("dispatch", matrix->commands[command], launched[job]);
+            matrix->jobQueue[job] = jobPID;
+            sigprocmask(SIG_UNBLOCK, &interruptSignal, nullptr);
+            next++;
+            running++;
+        }
+
+        // TODO: wait any job to be done
+        if (options.progress) {
+            res = ProgressWait(matrix, &wstatus, &progress);
+        }
+        else {
+            res = wait(&wstatus);
+        }
+        if (res == -1) {
+            process_wait_exception();
+        }
+        struct timeval end_t;
+        gettimeofday(&end_t, 0x0);
+        WaitStatusParser(res, wstatus, matrix);
+        running--;
+        int order = JobOrder(matrix, res);
+        reaped[order] = true;
+        trace_span("job", matrix->commands[order / matrix->filesPerCommand], launched[order]);
+        matrix->runtimeQueue[order] = (end_t.tv_sec - started[order].tv_sec) * 1000000L + (end_t.tv_usec - started[order].tv_usec);
+
+        if (history != nullptr) {
+            char note[SIZE_OF_DELIMITER_LINE];
+            if (matrix->predictQueue[order] >= 0) {
+                sprintf(note, "[Schedule]: predicted: %.0fms, actual: %.0fms", 
+                        matrix->predictQueue[order] / 1000.0, matrix->runtimeQueue[order] / 1000.0);
+            }
+            else {
+                sprintf(note, "[Schedule]: predicted: <no history>, actual: %.0fms", 
+                        matrix->runtimeQueue[order] / 1000.0);
+            }
+            CacheNote(res, KBLU, note);
+        }
+
+        // TODO: short-circuit remaining jobs once the outcome is decided by policy
+        if ((matrix->decidingJob == -1) && PolicyDecides(matrix->statusQueue[order])) {
+            matrix->decidingJob = order;
+            trace_instant("decided", matrix->commands[order / matrix->filesPerCommand]);
+            for (int i = 0; i < next; i++) {
+                if (!reaped[plan[i]]) {
+                    kill(-matrix->jobQueue[plan[i]], SIGTERM);
                 }
             }
+            for (; next < matrix->numberOfJobs; next++) {
+                matrix->statusQueue[plan[next]] = PROCESS_CANCELLED_WARNING;
+                board_set_state(&matrix->board[plan[next]], SLOT_CANCELLED);
+            }
+        }
+    }
+
+    if (options.progress) {
+        ProgressClear(&progress);
+        sigprocmask(SIG_SETMASK, &oldMask, nullptr);
+    }
+    interruptReaped = nullptr;
 
-            // TODO: free dynamic memory
-            if (args != nullptr) {
-                free(args);
+    // TODO: learn runtime of jobs run to their end for next run
+    if (history != nullptr) {
+        for (int i = 0; i < matrix->numberOfJobs; i++) {
+            if (RuntimeMeasured(matrix, i)) {
+                history_update(history, matrix->commands[i / matrix->filesPerCommand], 
+                               matrix->inputQueue[i], matrix->runtimeQueue[i]);
             }
         }
+        history_save(history);
+        free(history);
     }
+    free(plan);
+    free(reaped);
+    free(started);
+    free(launched);
 
-    return 0; 
+    return 0;
+}
+
+/**
+ * @brief DispatchPlanner
+ * 
+ * @param matrix: job matrix, input size and expected runtime of every job are filled in
+ * @param history: runtime history, nullptr to keep input order
+ * @param plan: job indices in dispatch order
+ * 
+ * The function will order jobs longest-expected-first, so a long job does not start last and
+ * extend the makespan. Jobs never seen before go first, larger input first, since they may be
+ * the longest of all.
+ */
+STATUS DispatchPlanner(IN JobMatrix* matrix, IN History* history, OUT int* plan) {
+    for (int i = 0; i < matrix->numberOfJobs; i++) {
+        struct stat st;
+        matrix->inputQueue[i] = 0;
+        if ((matrix->numberOfFiles > 0) && (stat(matrix->files[i % matrix->filesPerCommand], &st) == 0)) {
+            matrix->inputQueue[i] = st.st_size;
+        }
+        matrix->predictQueue[i] = -1;
+        if ((history != nullptr) && (strlen(matrix->commands[i / matrix->filesPerCommand]) > 0)) {
+            matrix->predictQueue[i] = history_predict(history, matrix->commands[i / matrix->filesPerCommand], 
+                                                      matrix->inputQueue[i]);
+        }
+        plan[i] = i;
+    }
+    if (history == nullptr) {
+        return 0;
+    }
+
+    // insertion sort keeps input order between equal jobs
+    for (int i = 1; i < matrix->numberOfJobs; i++) {
+        int job = plan[i];
+        int j = i - 1;
+        while ((j >= 0) && (DispatchBefore(matrix, job, plan[j]))) {
+            plan[j + 1] = plan[j];
+            j--;
+        }
+        plan[j + 1] = job;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief DispatchBefore
+ * 
+ * @return int: true if job 'a' should be dispatched before job 'b'
+ */
+int DispatchBefore(JobMatrix* matrix, int a, int b) {
+    long predictA = matrix->predictQueue[a];
+    long predictB = matrix->predictQueue[b];
+    if ((predictA < 0) && (predictB < 0)) {
+        return matrix->inputQueue[a] > matrix->inputQueue[b];
+    }
+    if ((predictA < 0) || (predictB < 0)) {
+        return predictA < 0;
+    }
+    return predictA > predictB;
+}
+
+/**
+ * @brief CacheNote
+ * 
+ * @param pid: process id of a finished job
+ * @param color: color of note
+ * @param note: one line note appended to cache of job
+ */
+void CacheNote(int pid, const char* color, const char* note) {
+    char cacheName[CACHE_NAME_SIZE];
+    sprintf(cacheName, "job_%d_cache", pid);
+    FILE* cache = fopen(cacheName, "a");
+    if (cache != nullptr) {
+        fprintf(cache, "%s%s%s\n", color, note, RESET);
+        fclose(cache);
+    }
+}
+
+/**
+ * @brief ProgressWait
+ * 
+ * @param matrix: job matrix
+ * @param wstatus: wstatus of finished job
+ * @param progress: state of live dashboard
+ * @return int: process id of finished job, -1 on error
+ * 
+ * The function will wait any job to be done like wait(), redrawing live dashboard every
+ * PROGRESS_INTERVAL in the meantime. It sleeps on SIGCHLD, so a finished job is reaped at once.
+ */
+int ProgressWait(IN JobMatrix* matrix, OUT int* wstatus, IN Progress* progress) {
+    sigset_t childSignal;
+    sigemptyset(&childSignal);
+    sigaddset(&childSignal, SIGCHLD);
+    while (true) {
+        int res = waitpid(-1, wstatus, WNOHANG);
+        if (res != 0) {
+            return res;
+        }
+        long now = board_now();
+        if (now >= progress->nextRender) {
+            ProgressRender(matrix, progress);
+            progress->nextRender = now + PROGRESS_INTERVAL;
+        }
+        long timeout = progress->nextRender - now;
+        struct timespec ts = {timeout / 1000000, (timeout % 1000000) * 1000};
+        sigtimedwait(&childSignal, nullptr, &ts);
+    }
+}
+
+/**
+ * @brief FormatBytes
+ * 
+ * @param bytes: number of bytes
+ * @param out: human readable size, at least 16 bytes
+ */
+void FormatBytes(long bytes, char* out) {
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double size = bytes;
+    int unit = 0;
+    while ((size >= 1024) && (unit < 4)) {
+        size /= 1024;
+        unit++;
+    }
+    sprintf(out, (unit == 0) ? "%.0f%s" : "%.1f%s", size, units[unit]);
+}
+
+/**
+ * @brief ProgressRender
+ * 
+ * @param matrix: job matrix
+ * @param progress: state of live dashboard
+ * 
+ * The function will draw live dashboard on stderr from result board: a summary line, then up to
+ * PROGRESS_MAX_ROWS running jobs, longest running first, so stragglers stay on top. Input read
+ * by a command comes from /proc/<pid>/io, read only for the rows shown.
+ */
+void ProgressRender(IN JobMatrix* matrix, IN Progress* progress) {
+    long now = board_now();
+    int pending = 0;
+    int running = 0;
+    int done = 0;
+    int rows[PROGRESS_MAX_ROWS];
+    int numberOfRows = 0;
+    for (int i = 0; i < matrix->numberOfJobs; i++) {
+        int state = board_state(&matrix->board[i]);
+        if (state == SLOT_PENDING) {
+            pending++;
+            continue;
+        }
+        if ((state == SLOT_DONE) || (state == SLOT_CANCELLED)) {
+            done++;
+            continue;
+        }
+        running++;
+        // keep rows sorted by start time, oldest first
+        int j = (numberOfRows < PROGRESS_MAX_ROWS) ? numberOfRows++ : PROGRESS_MAX_ROWS;
+        while ((j > 0) && (matrix->board[rows[j - 1]].startTime > matrix->board[i].startTime)) {
+            if (j < PROGRESS_MAX_ROWS) {
+                rows[j] = rows[j - 1];
+            }
+            j--;
+        }
+        if (j < PROGRESS_MAX_ROWS) {
+            rows[j] = i;
+        }
+    }
+
+    if (!progress->terminal) {
+        fprintf(stderr, "mash: %d/%d done, %d running, %d pending, elapsed %.1fs\n", 
+                done, matrix->numberOfJobs, running, pending, (now - progress->startTime) / 1e6);
+        return;
+    }
+    if (progress->drawnLines > 0) {
+        fprintf(stderr, "\033[%dA", progress->drawnLines); // back to top of dashboard
+    }
+    fprintf(stderr, "\033[K%smash: %d/%d done, %d running, %d pending, elapsed %.1fs%s\n", 
+            KBLU, done, matrix->numberOfJobs, running, pending, (now - progress->startTime) / 1e6, RESET);
+    for (int r = 0; r < numberOfRows; r++) {
+        JobSlot* slot = &matrix->board[rows[r]];
+        double elapsed = (now - slot->startTime) / 1e6;
+        char output[16];
+        FormatBytes(__atomic_load_n(&slot->bytes, __ATOMIC_RELAXED), output);
+        fprintf(stderr, "\033[K  CMD %d %-24.24s %-8s %6.1fs  out: %8s %8ld lines", 
+                rows[r] / matrix->filesPerCommand + 1, JobFile(matrix, rows[r]), 
+                (board_state(slot) == SLOT_RUNNING) ? "running" : "starting", elapsed, 
+                output, __atomic_load_n(&slot->lines, __ATOMIC_RELAXED));
+
+        // input consumed by command, only measurable for a local command
+        char ioName[64];
+        sprintf(ioName, "/proc/%d/io", slot->execPid);
+        FILE* io = (slot->execPid > 0) ? fopen(ioName, "r") : nullptr;
+        long rchar = -1;
+        if (io != nullptr) {
+            char line[128];
+            while (fgets(line, sizeof(line), io) != nullptr) {
+                if (sscanf(line, "rchar: %ld", &rchar) == 1) {
+                    break;
+                }
+            }
+            fclose(io);
+        }
+        if (rchar >= 0) {
+            char input[16];
+            char rate[16];
+            FormatBytes(rchar, input);
+            FormatBytes((elapsed > 0) ? (long)(rchar / elapsed) : 0, rate);
+            fprintf(stderr, "  in: %8s (%s/s)", input, rate);
+            // rchar counts every read, only a fraction of target file is a meaningful estimate
+            if ((matrix->inputQueue[rows[r]] > 0) && (rchar <= matrix->inputQueue[rows[r]])) {
+                fprintf(stderr, " %3.0f%%", 100.0 * rchar / matrix->inputQueue[rows[r]]);
+            }
+        }
+        fprintf(stderr, "\n");
+    }
+    // wipe rows left from previous frame
+    for (int r = numberOfRows + 1; r < progress->drawnLines; r++) {
+        fprintf(stderr, "\033[K\n");
+    }
+    if (progress->drawnLines > numberOfRows + 1) {
+        fprintf(stderr, "\033[%dA", progress->drawnLines - numberOfRows - 1);
+    }
+    progress->drawnLines = numberOfRows + 1;
+}
+
+/**
+ * @brief ProgressClear
+ * 
+ * @param progress: state of live dashboard
+ * 
+ * The function will erase live dashboard before report is printed.
+ */
+void ProgressClear(IN Progress* progress) {
+    if (!progress->terminal || (progress->drawnLines == 0)) {
+        return;
+    }
+    fprintf(stderr, "\033[%dA\033[J", progress->drawnLines);
+    progress->drawnLines = 0;
+}
+
+/**
+ * @brief PolicyDecides
+ * 
+ * @param statusCode: status code of a finished job
+ * @return int: true if the job decides outcome of the whole run under options.policy
+ */
+int PolicyDecides(int statusCode) {
+    if (options.policy == POLICY_RACE) {
+        return statusCode == 0;
+    }
+    if (options.policy == POLICY_FAIL_FAST) {
+        return (statusCode != 0) && (statusCode != PROCESS_NO_COMMAND_WARNING);
+    }
+    return false;
+}
+
+/**
+ * @brief JobOrder
+ * 
+ * @param matrix: job matrix
+ * @param pid: process id of a job
+ * @return int: index of job in matrix, 0 if not found
+ */
+int JobOrder(JobMatrix* matrix, int pid) {
+    for (int i = 0; i < matrix->numberOfJobs; i++) {
+        if (pid == matrix->jobQueue[i]) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief RuntimeMeasured
+ * 
+ * @param matrix: job matrix
+ * @param job: index of job in matrix
+ * @return int: true if runtime of job is that of its command run to its end
+ * 
+ * A command exiting with non-zero status (e.g. 'grep' finding nothing) still ran to its end, while
+ * a job cancelled by policy or killed by a signal did not.
+ */
+int RuntimeMeasured(JobMatrix* matrix, int job) {
+    JobStatus* record = &matrix->board[job].status;
+    int status = matrix->statusQueue[job];
+    return (matrix->jobQueue[job] != 0) && ((status == 0) || ((status == PROCESS_COMMAND_STATUS_ERROR) &&
+        (record->startTime != 0) && WIFEXITED(record->waitStatus)));
+}
+
+/**
+ * @brief CacheTotal
+ * 
+ * @param cacheName: cache file of a job
+ * @param bytes: bytes of output written by command, as counted while relaying
+ * @param file: target file of the job, nullptr if none
+ * @param total: sum of numbers found in output
+ * @return int: true if every output line of the job is a count
+ * 
+ * The function will sum the counts printed by a command (e.g. 'wc -l', 'grep -c'). A line is a
+ * count if it is a bare number, or a number followed by whitespace and the target file as 'wc'
+ * prints it. Any other line, like a timestamped log line, makes the output non-numeric.
+ */
+int CacheTotal(const char* cacheName, long bytes, const char* file, long* total) {
+    FILE* cache = fopen(cacheName, "r");
+    if (cache == nullptr) {
+        return false;
+    }
+    char* line = nullptr;
+    size_t capacity = 0;
+    ssize_t size = getline(&line, &capacity, cache); // skip header line
+    int numeric = (size != -1);
+    long sum = 0;
+    while (numeric && (bytes > 0) && ((size = getline(&line, &capacity, cache)) != -1)) {
+        if (size > bytes) {
+            size = bytes;
+        }
+        bytes -= size;
+        while ((size > 0) && isspace((unsigned char)line[size - 1])) {
+            line[--size] = '\0';
+        }
+        char* start = line + strspn(line, " \t");
+        char* end;
+        long value = strtol(start, &end, 10);
+        if (end == start) {
+            numeric = false;
+        }
+        else if (*end != '\0') {
+            char* rest = end + strspn(end, " \t");
+            numeric = (rest != end) && (file != nullptr) && (strcmp(rest, file) == 0);
+        }
+        sum += value;
+    }
+    free(line);
+    fclose(cache);
+
+    *total = sum;
+    return numeric;
+}
+
+/**
+ * @brief CompareReport
+ * 
+ * @param matrix: job matrix
+ * @param f: index of target file
+ * 
+ * The function will group commands run on target file by digest of their output, then print a
+ * line-level diff of every other group against the first one. Only jobs whose command ran are
+ * compared, whatever its exit status. Caches are streamed, never loaded as a whole.
+ */
+void CompareReport(IN JobMatrix* matrix, IN int f) {
+    int jobs[NUM_OF_JOBS];
+    int group[NUM_OF_JOBS];
+    CompareDigest digest[NUM_OF_JOBS];
+    char cacheName[NUM_OF_JOBS][CACHE_NAME_SIZE];
+    int size = 0;
+    int groups = 0;
+    for (int c = 0; c < NUM_OF_JOBS; c++) {
+        int job = c * matrix->filesPerCommand + f;
+        int status = matrix->statusQueue[job];
+        // record filled in by main for a killed job process has no output counted
+        if ((matrix->jobQueue[job] == 0) || (board_state(&matrix->board[job]) != SLOT_DONE) ||
+            (matrix->board[job].status.startTime == 0) ||
+            ((status != 0) && (status != PROCESS_COMMAND_STATUS_ERROR))) {
+            continue;
+        }
+        sprintf(cacheName[size], "job_%d_cache", matrix->jobQueue[job]);
+        if (compare_digest(cacheName[size], matrix->board[job].status.bytes, &digest[size]) == -1) {
+            continue;
+        }
+        group[size] = groups;
+        for (int k = 0; k < size; k++) {
+            if ((digest[k].hash == digest[size].hash) && (digest[k].bytes == digest[size].bytes)) {
+                group[size] = group[k];
+                break;
+            }
+        }
+        if (group[size] == groups) {
+            groups++;
+        }
+        jobs[size++] = job;
+    }
+    if (size < 2) {
+        return;
+    }
+
+    const char* file = (strlen(JobFile(matrix, jobs[0])) == 0) ? "<blank>" : JobFile(matrix, jobs[0]);
+    printf("Compare on %s: %s", file, (groups == 1) ? "identical output of " : "");
+    for (int g = 0; g < groups; g++) {
+        int first = true;
+        for (int k = 0; k < size; k++) {
+            if (group[k] != g) {
+                continue;
+            }
+            if (first) {
+                printf("%s", (g == 0) ? "" : " | ");
+                first = false;
+            }
+            else {
+                printf(" = ");
+            }
+            printf("CMD %d", jobs[k] / matrix->filesPerCommand + 1);
+        }
+    }
+    if (groups > 1) {
+        printf(" (%d groups)", groups);
+    }
+    printf("\n");
+
+    // TODO: diff representative of each group against first group
+    for (int g = 1; g < groups; g++) {
+        int k = 0;
+        while (group[k] != g) {
+            k++;
+        }
+        printf("--- CMD %d: %ld lines\n+++ CMD %d: %ld lines\n", 
+               jobs[0] / matrix->filesPerCommand + 1, digest[0].lines, 
+               jobs[k] / matrix->filesPerCommand + 1, digest[k].lines);
+        fflush(stdout);
+        compare_diff(cacheName[0], digest[0].bytes, cacheName[k], digest[k].bytes, stdout);
+    }
 }
 
 /**
@@ -383,28 +1687,32 @@ STATUS Worker(IN const char* command, IN const char* file, IN int order) {
  * 1. detailed report is generated by a new process.
  * 2. summary is written to stdout.
  */
-STATUS Reporter(int* jobQueue, int* statusQueue, double runtimeMain, char* file) {
-    // TODO: find cache file 'job_{res_job1}_cache' and output cache file in order
+STATUS Reporter(JobMatrix* matrix, double runtimeMain, char* file) {
+    // TODO: find cache file 'job_{pid}_cache' and output cache file in order
     int detailID = fork();
     if (detailID == -1) {
         process_allocation_exception();
     }
     if (detailID == 0) {
-        char cacheName1[CACHE_NAME_SIZE];
-        char cacheName2[CACHE_NAME_SIZE];
-        char cacheName3[CACHE_NAME_SIZE];
-        sprintf(cacheName1, "job_%d_cache", jobQueue[0]);
-        sprintf(cacheName2, "job_%d_cache", jobQueue[1]);
-        sprintf(cacheName3, "job_%d_cache", jobQueue[2]);
-        if ((access(cacheName1, F_OK) == 0) && (access(cacheName2, F_OK) == 0) && (access(cacheName1, F_OK) == 0)){
-            int status = execlp("cat", "cat", cacheName1, cacheName2, cacheName3, (char*)NULL);
-            if (status == -1) {
-                process_execvp_exception("cat");
+        // args: {"cat", cache files..., NULL}
+        char** args = malloc(sizeof(char*) * (matrix->numberOfJobs + 2));
+        int size = 0;
+        args[size++] = "cat";
+        for (int i = 0; i < matrix->numberOfJobs; i++) {
+            char* cacheName = malloc(CACHE_NAME_SIZE);
+            sprintf(cacheName, "job_%d_cache", matrix->jobQueue[i]);
+            if ((matrix->jobQueue[i] != 0) && (access(cacheName, F_OK) == 0)) {
+                args[size++] = cacheName;
             }
         }
-        else {
+        args[size] = nullptr;
+        if (size == 1) {
             exit(-1);
         }
+        int status = execvp("cat", args);
+        if (status == -1) {
+            process_execvp_exception("cat");
+        }
     }
     else {
         int wstatus = 0;
@@ -426,27 +1734,123 @@ STATUS Reporter(int* jobQueue, int* statusQueue, double runtimeMain, char* file)
 
         int success = 0;
         int warning = 0;
-        for (int i = 0; i < NUM_OF_JOBS; i++) {
-            if (statusQueue[i] == 0) {
+        int cancelled = 0;
+        for (int i = 0; i < matrix->numberOfJobs; i++) {
+            if (matrix->statusQueue[i] == 0) {
                 success++;
             }
-            if (statusQueue[i] == PROCESS_NO_COMMAND_WARNING) {
+            if (matrix->statusQueue[i] == PROCESS_NO_COMMAND_WARNING) {
                 warning++;
             }
+            if (matrix->statusQueue[i] == PROCESS_CANCELLED_WARNING) {
+                cancelled++;
+            }
         }
         
         printf("Summary: success: %d, warning: %d, failure: %d", 
-               success, warning, 3 - success - warning);
+               success, warning, matrix->numberOfJobs - success - warning - cancelled);
+        if (options.policy != POLICY_ALL) {
+            printf(", cancelled: %d", cancelled);
+        }
         if (strlen(file) == 0) {
             printf("\t  Target file: <blank>\n");
         }
         else {
             printf("\t  Target file: %s\n", file);
         }
+
+        if (options.backend != &localBackend) {
+            printf("Backend: %s, %d agents\n", options.backend->name, options.numberOfAgents);
+        }
+
+        // TODO: report which job decided outcome under short-circuit policy
+        if (matrix->decidingJob != -1) {
+            int decider = matrix->decidingJob;
+            printf("Decided by: CMD %d", decider / matrix->filesPerCommand + 1);
+            if (matrix->numberOfFiles > 1) {
+                printf(" on %s", matrix->files[decider % matrix->filesPerCommand]);
+            }
+            printf(" [pid: %d] (%s)\n", matrix->jobQueue[decider], 
+                   (options.policy == POLICY_RACE) ? "first success wins" : "fail fast");
+        }
+        else if (options.policy == POLICY_RACE) {
+            printf("Decided by: <none>, no job succeeded\n");
+        }
+
+        // TODO: report accuracy of runtime history
+        if (options.historyFile != nullptr) {
+            int predicted = 0;
+            int measured = 0;   // predicted jobs run to their end, a cut short runtime is no error
+            double error = 0;
+            for (int i = 0; i < matrix->numberOfJobs; i++) {
+                if ((matrix->jobQueue[i] != 0) && (matrix->predictQueue[i] >= 0)) {
+                    predicted++;
+                }
+                if (RuntimeMeasured(matrix, i) && (matrix->predictQueue[i] >= 0)) {
+                    measured++;
+                    error += labs(matrix->predictQueue[i] - matrix->runtimeQueue[i]) / 1000.0;
+                }
+            }
+            printf("Schedule: longest-expected-first, predicted: %d/%d jobs", predicted, matrix->numberOfJobs);
+            if (measured > 0) {
+                printf(", mean error: %.0fms over %d", error / measured, measured);
+            }
+            printf("\n");
+        }
+
+        // TODO: output volume read from result board
+        long bytes = 0;
+        long lines = 0;
+        for (int i = 0; i < matrix->numberOfJobs; i++) {
+            bytes += __atomic_load_n(&matrix->board[i].bytes, __ATOMIC_RELAXED);
+            lines += __atomic_load_n(&matrix->board[i].lines, __ATOMIC_RELAXED);
+        }
+        printf("Output of commands: %ld bytes, %ld lines\n", bytes, lines);
+
+        // TODO: aggregate numeric output of each command over all files
+        if (matrix->numberOfFiles > 1) {
+            for (int c = 0; c < NUM_OF_JOBS; c++) {
+                long total = 0;
+                int numeric = true;
+                int counted = 0;
+                for (int f = 0; numeric && (f < matrix->filesPerCommand); f++) {
+                    int job = c * matrix->filesPerCommand + f;
+                    JobStatus* record = &matrix->board[job].status;
+                    int status = matrix->statusQueue[job];
+                    // 'grep -c' finding nothing exits 1, its count of 0 still belongs to total
+                    int counts = (status == 0) || ((status == PROCESS_COMMAND_STATUS_ERROR) &&
+                        (record->startTime != 0) && WIFEXITED(record->waitStatus) &&
+                        (WEXITSTATUS(record->waitStatus) == 1));
+                    if ((matrix->jobQueue[job] == 0) || !counts) {
+                        continue;
+                    }
+                    char cacheName[CACHE_NAME_SIZE];
+                    sprintf(cacheName, "job_%d_cache", matrix->jobQueue[job]);
+                    long value;
+                    numeric = CacheTotal(cacheName, record->bytes, matrix->files[f], &value);
+                    total += value;
+                    counted++;
+                }
+                if (numeric && (counted == matrix->filesPerCommand)) {
+                    printf("Total of CMD %d: %ld over %d files\n", c + 1, total, counted);
+                }
+                else if (numeric && (counted > 0)) {
+                    printf("Total of CMD %d: %ld over %d of %d files\n", c + 1, total, counted,
+                        matrix->filesPerCommand);
+                }
+            }
+        }
         
+        // TODO: compare output of commands on each target file
+        if (options.compare) {
+            for (int f = 0; f < matrix->filesPerCommand; f++) {
+                CompareReport(matrix, f);
+            }
+        }
+
         printf("Children process IDs (status code): ");
-        for (int i = 0; i < NUM_OF_JOBS; i++) {
-            printChildrenProcess(jobQueue[i], statusQueue[i]);
+        for (int i = 0; i < matrix->numberOfJobs; i++) {
+            printChildrenProcess(matrix->jobQueue[i], matrix->statusQueue[i], &matrix->board[i].status);
         }
 
         printf("\n");
@@ -464,19 +1868,25 @@ STATUS Reporter(int* jobQueue, int* statusQueue, double runtimeMain, char* file)
  * 
  * The function will clean cache file generated by worker processes
  */
-STATUS Cleaner(int* jobQueue) {
+STATUS Cleaner(JobMatrix* matrix) {
     int cacheID = fork();
     if (cacheID == -1) {
         process_allocation_exception();
     }
     if (cacheID == 0) {
-        char cacheName1[CACHE_NAME_SIZE];
-        char cacheName2[CACHE_NAME_SIZE];
-        char cacheName3[CACHE_NAME_SIZE];
-        sprintf(cacheName1, "job_%d_cache", jobQueue[0]);
-        sprintf(cacheName2, "job_%d_cache", jobQueue[1]);
-        sprintf(cacheName3, "job_%d_cache", jobQueue[2]);
-        int status = execlp("rm", "rm", "-rf", cacheName1, cacheName2, cacheName3, nullptr);
+        // args: {"rm", "-rf", cache files..., NULL}
+        char** args = malloc(sizeof(char*) * (matrix->numberOfJobs + 3));
+        int size = 0;
+        args[size++] = "rm";
+        args[size++] = "-rf";
+        for (int i = 0; i < matrix->numberOfJobs; i++) {
+            if (matrix->jobQueue[i] != 0) {
+                args[size] = malloc(CACHE_NAME_SIZE);
+                sprintf(args[size++], "job_%d_cache", matrix->jobQueue[i]);
+            }
+        }
+        args[size] = nullptr;
+        int status = execvp("rm", args);
         if (status == -1) {
             process_execvp_exception("rm");
         }
@@ -499,32 +1909,64 @@ STATUS Cleaner(int* jobQueue) {
 }
 
 
-void WaitStatusParser(int pid, int wstatus, int* jobQueue, int* statusQueue) {
-    int order = 0;
-    for (int i = 0; i < NUM_OF_JOBS; i++) {
-        if (pid == jobQueue[i]) {
-            order = i;
-            break;
-        }
-    }
+void WaitStatusParser(int pid, int wstatus, JobMatrix* matrix) {
+    int order = JobOrder(matrix, pid);
 
-    if (order == 0) {
+    // live dashboard shows finished jobs itself
+    if (!options.progress && (matrix->numberOfFiles > 1)) {
+        printf("CMD %d on %s [pid: %d] is finished...\n", 
+               order / matrix->filesPerCommand + 1, matrix->files[order % matrix->filesPerCommand], pid);
+    }
+    else if (!options.progress && (order == 0)) {
         printf("First process [pid: %d] is finished...\n", pid);
     }
-    else if (order == 1) {
+    else if (!options.progress && (order == 1)) {
         printf("Second process [pid: %d] is finished...\n", pid);
     }
-    else {
+    else if (!options.progress) {
         printf("Third process [pid: %d] is finished...\n", pid);
     }
 
-    if (WIFEXITED(wstatus)) {
+    if (board_state(&matrix->board[order]) == SLOT_DONE) {
+        matrix->statusQueue[order] = matrix->board[order].status.mashCode;
+    }
+    else if (WIFEXITED(wstatus)) {
         int statusCode = WEXITSTATUS(wstatus);
-        statusQueue[order] = statusCode;
+        matrix->statusQueue[order] = statusCode;
+    }
+    else if (WIFSIGNALED(wstatus) && (matrix->decidingJob != -1)) {
+        // killed by short-circuit policy, leave a note at the end of its cache
+        matrix->statusQueue[order] = PROCESS_CANCELLED_WARNING;
+        board_set_state(&matrix->board[order], SLOT_CANCELLED);
+        char note[SIZE_OF_DELIMITER_LINE];
+        sprintf(note, "[Cancelled]: outcome already decided by CMD %d.", 
+                matrix->decidingJob / matrix->filesPerCommand + 1);
+        CacheNote(pid, KYEL, note);
+    }
+    else if (WIFSIGNALED(wstatus)) {
+        // job process died before publishing its record, it must not count as a success
+        JobStatus* record = &matrix->board[order].status;
+        record->job = order;
+        record->pid = pid;
+        record->mashCode = PROCESS_COMMAND_STATUS_ERROR;
+        record->waitStatus = wstatus;
+        record->signal = WTERMSIG(wstatus);
+        board_set_state(&matrix->board[order], SLOT_DONE);
+        matrix->statusQueue[order] = PROCESS_COMMAND_STATUS_ERROR;
+        char note[SIZE_OF_DELIMITER_LINE];
+        sprintf(note, "[Failure]: job process is killed by signal %d.", WTERMSIG(wstatus));
+        CacheNote(pid, KRED, note);
     }
 }
 
 int main(int argc, char* argv[]) {
+    OptionParser(argc, argv);
+    if (options.agentPort > 0) {
+        Agent(options.agentPort);
+    }
+    trace_init(options.traceFile);
+
+    long traceStart = trace_now();
     int message[2]; // 0 for read, 1 for write
     if (pipe(message) == -1) {
         process_pipe_exception();
@@ -543,105 +1985,138 @@ int main(int argc, char* argv[]) {
         if (res != uiPID) {
             process_wait_exception();
         }
+        trace_span("collect", nullptr, traceStart);
 
         // TODO: parse message from pipe
+        traceStart = trace_now();
         int numberOfEntries = 0; 
         char** commands = nullptr;
         MessageParser(message, &numberOfEntries, &commands);
         char* file = commands[numberOfEntries-1];
+        trace_span("parse", nullptr, traceStart);
+
+        // TODO: build job matrix, every command against every target file
+        traceStart = trace_now();
+        JobMatrix matrix;
+        matrix.commands = commands;
+        if (options.backend == &remoteBackend) {
+            RemoteExpander(file, &matrix.files, &matrix.numberOfFiles);
+        }
+        else {
+            TargetExpander(file, &matrix.files, &matrix.numberOfFiles);
+        }
+        trace_span("expand", file, traceStart);
+        matrix.filesPerCommand = (matrix.numberOfFiles > 0) ? matrix.numberOfFiles : 1;
+        matrix.numberOfJobs = NUM_OF_JOBS * matrix.filesPerCommand;
+        matrix.jobQueue = calloc(matrix.numberOfJobs, sizeof(int));
+        matrix.statusQueue = calloc(matrix.numberOfJobs, sizeof(int));
+        matrix.decidingJob = -1;
+        matrix.inputQueue = calloc(matrix.numberOfJobs, sizeof(long));
+        matrix.predictQueue = calloc(matrix.numberOfJobs, sizeof(long));
+        matrix.runtimeQueue = calloc(matrix.numberOfJobs, sizeof(long));
+        matrix.board = board_create(matrix.numberOfJobs);
+        if (matrix.board == nullptr) {
+            process_allocation_exception();
+        }
+
+        // TODO: terminate jobs and remove their cache files if interrupted
+        mainPID = getpid();
+        interruptMatrix = &matrix;
+        struct sigaction interrupt;
+        memset(&interrupt, 0, sizeof(interrupt));
+        interrupt.sa_handler = InterruptHandler;
+        sigemptyset(&interrupt.sa_mask);
+        sigaddset(&interrupt.sa_mask, SIGINT);
+        sigaddset(&interrupt.sa_mask, SIGTERM);
+        sigaddset(&interrupt.sa_mask, SIGHUP);
+        sigaction(SIGINT, &interrupt, nullptr);
+        sigaction(SIGTERM, &interrupt, nullptr);
+        sigaction(SIGHUP, &interrupt, nullptr);
 
         // TODO: Dispatch tasks to children processes
-        int job1PID = fork();
-        if (job1PID == -1) {
+        struct timeval start_main, end_main;
+        gettimeofday(&start_main, 0x0);
+        printf("\n"); 
+        Scheduler(&matrix);
+
+        gettimeofday(&end_main, 0x0);
+        int runtime_main = (end_main.tv_sec - start_main.tv_sec) * 1000000 + (end_main.tv_usec - start_main.tv_usec);
+        double runtimeMain = (double)runtime_main / 1000;
+
+        if (DEBUG) {
+            printf("Main Process: after waiting all working process done:\n");
+            for (int i = 0; i < matrix.numberOfJobs; i++) {
+                printf("job%d id = %d, status code = %d\n", i + 1, matrix.jobQueue[i], matrix.statusQueue[i]);
+            }
+            printf("\n");
+        }
+
+        int wstatus;
+        traceStart = trace_now();
+        fflush(stdout);
+        int reporterPID = fork();
+        if (reporterPID == -1) {
             process_allocation_exception();
         }
-        if (job1PID == 0) {
-            // TODO: Job1 Process
-            Worker(commands[0], file, 1);
+        if (reporterPID == 0) {
+            Reporter(&matrix, runtimeMain, file);
+            exit(0);
         }
-        else {
-            int job2PID = fork();
-            if (job2PID == -1) {
-                process_allocation_exception();
-            }
-            if (job2PID == 0) {
-                // TODO: Job2 Process
-                Worker(commands[1], file, 2);
-            }
-            else {
-                int job3PID = fork();
-                if (job3PID == -1) {
-                    process_allocation_exception();
-                }
-                if (job3PID == 0) {
-                    // TODO: Job3 Process
-                    Worker(commands[2], file, 3);
-                }
-                else {
-                    // TODO: Main Process:
-                    struct timeval start_main, end_main;
-                    gettimeofday(&start_main, 0x0);
-                    
-                    int jobQueue[NUM_OF_JOBS] = {job1PID, job2PID, job3PID};
-                    int statusQueue[NUM_OF_JOBS] = {0, 0, 0};
-                    int wstatus;
-                    int res;
-                    printf("\n"); 
-                    res = wait(&wstatus);
-                    WaitStatusParser(res, wstatus, jobQueue, statusQueue);
-                    res = wait(&wstatus);
-                    WaitStatusParser(res, wstatus, jobQueue, statusQueue);
-                    res = wait(&wstatus);
-                    WaitStatusParser(res, wstatus, jobQueue, statusQueue);
-                    
-                    gettimeofday(&end_main, 0x0);
-                    int runtime_main = (end_main.tv_sec - start_main.tv_sec) * 1000000 + (end_main.tv_usec - start_main.tv_usec);
-                    double runtimeMain = (double)runtime_main / 1000;
-
-                    if (DEBUG) {
-                        printf("Main Process: after waiting three working process done:\n");
-                        printf("job1 id = %d, status code = %d\n", jobQueue[0], statusQueue[0]);
-                        printf("res_job2 = %d, status code = %d\n", jobQueue[1], statusQueue[1]);
-                        printf("res_job3 = %d, status code = %d\n", jobQueue[2], statusQueue[2]);
-                        printf("\n");
-                    }
+        int output_res = wait(&wstatus);
+        if (output_res == -1) {
+            process_wait_exception();
+        }
+        trace_span("report", nullptr, traceStart);
 
-                    int reporterPID = fork();
-                    if (reporterPID == -1) {
-                        process_allocation_exception();
-                    }
-                    if (reporterPID == 0) {
-                        Reporter(jobQueue, statusQueue, runtimeMain, file);
-                    }
-                    else {
-                        int output_res = wait(&wstatus);
-                        if (output_res == -1) {
-                            process_wait_exception();
-                        }
-
-                        int cleanerPID = fork();
-                        if (cleanerPID == -1) {
-                            process_allocation_exception();
-                        }
-                        if (cleanerPID == 0) {
-                            Cleaner(jobQueue);
-                        }
-                        else {
-                            // TODO: delete dynamic memory
-                            for (int i = 0; i < numberOfEntries; i++) {
-                                if (commands[i] != nullptr) {
-                                    free(commands[i]);
-                                    commands[i] = nullptr;
-                                }
-                            }
-                            if (commands != nullptr) {
-                                free(commands);
-                            }
-                        }                        
-                    }                    
-                }
+        traceStart = trace_now();
+        fflush(stdout);
+        int cleanerPID = fork();
+        if (cleanerPID == -1) {
+            process_allocation_exception();
+        }
+        if (cleanerPID == 0) {
+            Cleaner(&matrix);
+            exit(0);
+        }
+        int clean_res = wait(&wstatus);
+        if (clean_res == -1) {
+            process_wait_exception();
+        }
+        trace_span("clean", nullptr, traceStart);
+        interruptMatrix = nullptr;
+        trace_dump();
+
+        // TODO: delete dynamic memory
+        for (int i = 0; i < numberOfEntries; i++) {
+            if (commands[i] != nullptr) {
+                free(commands[i]);
+                commands[i] = nullptr;
             }
         }
+        if (commands != nullptr) {
+            free(commands);
+        }
+        for (int i = 0; i < matrix.numberOfFiles; i++) {
+            free(matrix.files[i]);
+        }
+        if (matrix.files != nullptr) {
+            free(matrix.files);
+        }
+        // TODO: exit status reflects outcome under short-circuit policy
+        int outcome = 0;
+        if ((options.policy == POLICY_RACE) && (matrix.decidingJob == -1)) {
+            outcome = 1;
+        }
+        if ((options.policy == POLICY_FAIL_FAST) && (matrix.decidingJob != -1)) {
+            outcome = 1;
+        }
+        free(matrix.jobQueue);
+        free(matrix.statusQueue);
+        free(matrix.inputQueue);
+        free(matrix.predictQueue);
+        free(matrix.runtimeQueue);
+        board_destroy(matrix.board, matrix.numberOfJobs);
+        return outcome;
     }
 
     return 0;
@@ -12,6 +12,10 @@
 #ifndef MASH_H
 #define MASH_H
 
+#include "mashhistory.h"
+#include "masherror.h"
+#include "mashboard.h"
+
 #define DEBUG 0
 
 // Global Defines
@@ -25,16 +29,96 @@
 
 // UI Process
 #define MESSAGE_MAX_SIZE 10000
-#define USER_INPUT_MAX_SIZE 255
+#define USER_INPUT_MAX_SIZE 1024
 
 // Worker Process
 #define CACHE_NAME_SIZE 20
+#define RELAY_BUFFER_SIZE 65536
 #define COMMAND_MAX_SIZE 20;
 const char* target_commands[] = {
-    "grep", "sed", "ls", "wc", "as", 
+    "grep", "sed", "ls", "wc", "as", "mgrep", 
 };
 #define SIZE_OF_TARGET_COMMAND (sizeof(target_commands) / sizeof(const char*))
 
+// Job Matrix
+#define FILE_DELIMITER " \t"
+
+// Short-circuit Policy
+#define POLICY_ALL 0            // run every job to completion
+#define POLICY_RACE 1           // first success wins, remaining jobs are cancelled
+#define POLICY_FAIL_FAST 2      // first failure cancels remaining jobs
+
+struct JobMatrix;
+
+/**
+ * @brief ExecBackend
+ * 
+ * How a job is executed. 'launch' forks a job process which runs the job and leaves its output
+ * in 'job_{pid}_cache', and returns its process id. Main process waits and cancels job processes
+ * the same way whatever backend runs them.
+ */
+typedef struct {
+    const char* name;
+    int (*launch)(struct JobMatrix* matrix, int job);
+} ExecBackend;
+
+/**
+ * @brief MashOptions
+ * 
+ * Options given on the command line of mash.
+ */
+typedef struct {
+    int maxJobs;            // max number of job processes running at the same time
+    char* traceFile;        // Chrome trace JSON output, nullptr if tracing is disabled
+    int policy;             // POLICY_ALL, POLICY_RACE or POLICY_FAIL_FAST
+    char* historyFile;      // runtime history for scheduling, nullptr to keep input order
+    ExecBackend* backend;   // local fork/exec or remote agents
+    char** agents;          // agent addresses 'host:port' of remote backend
+    int numberOfAgents;     // size of agents
+    int agentPort;          // port to serve on in agent mode, 0 if not an agent
+    char* agentAddress;     // address to serve on in agent mode, nullptr for loopback
+    int progress;           // true to show live dashboard
+    int compare;            // true to compare output of commands on each target file
+    int indexLines;         // lines per block of sidecar index, 0 to scan without index
+} MashOptions;
+
+/**
+ * @brief JobMatrix
+ * 
+ * Every command is run against every target file. Job 'j' runs command 'j / filesPerCommand'
+ * against file 'j % filesPerCommand', so jobs are grouped per command and then per file.
+ */
+typedef struct JobMatrix {
+    char** commands;        // NUM_OF_JOBS command strings
+    char** files;           // expanded target files, nullptr if file field is blank
+    int numberOfFiles;      // size of 'files'
+    int filesPerCommand;    // max(numberOfFiles, 1)
+    int numberOfJobs;       // NUM_OF_JOBS * filesPerCommand
+    int* jobQueue;          // process id of each job, 0 if never launched
+    int* statusQueue;       // status code responding to jobQueue
+    int decidingJob;        // job deciding outcome under short-circuit policy, -1 if none
+    long* inputQueue;       // size of target file of each job in bytes
+    long* predictQueue;     // expected runtime of each job in microseconds, -1 if unknown
+    long* runtimeQueue;     // runtime of each job from dispatch to exit in microseconds
+    JobSlot* board;         // result board shared with jobs, one slot per job
+} JobMatrix;
+
+// Live Dashboard
+#define PROGRESS_INTERVAL 250000 // microseconds between two frames
+#define PROGRESS_MAX_ROWS 12
+
+/**
+ * @brief Progress
+ * 
+ * State of live dashboard kept by main process.
+ */
+typedef struct {
+    long startTime;         // microseconds since epoch
+    long nextRender;        // microseconds since epoch
+    int drawnLines;         // lines of last frame on terminal
+    int terminal;           // true if stderr is a terminal, otherwise plain lines are printed
+} Progress;
+
 // Output Format
 #define SIZE_OF_DELIMITER_LINE 80
 #define KRED "\x1B[31m"
@@ -66,6 +150,39 @@ STATUS MsgCollector(IN int* message);
  */
 STATUS MessageParser(IN int* message, IN int* numberOfEntries, OUT char*** commands_out);
 
+/**
+ * @brief OptionParser
+ * 
+ * @param argc: argument count
+ * @param argv: argument list
+ * 
+ * The function will parse command line options of mash into global options.
+ *   -j N: run at most N job processes at the same time (default: number of online cores, at least 3).
+ *   -t file: record lifecycle events of mash and dump them to file as Chrome trace JSON.
+ *   -m mode: 'all' runs every job (default), 'race' stops remaining jobs once a job succeeds,
+ *            'failfast' stops remaining jobs once a job fails.
+ *   -H file: runtime history used to schedule longest-expected-first, e.g. ~/.mash_history
+ *            (default: off, jobs keep input order and nothing is recorded).
+ *   -r host:port,...: ship jobs to mash agents instead of running them on this host.
+ *   -a [address:]port: run as an agent serving remote jobs on port of address, loopback by default.
+ *   -p: show live progress of running jobs on stderr.
+ *   -c: compare output of commands on each target file.
+ *   -i lines|off: lines per block of sidecar index used by mgrep, 'off' to scan without it.
+ */
+STATUS OptionParser(IN int argc, IN char* argv[]);
+
+/**
+ * @brief TargetExpander
+ * 
+ * @param file: raw file field, a list of files or glob patterns separated by spaces
+ * @param files_out: expanded file names
+ * @param size_o: size of files_out
+ * 
+ * The function will expand every pattern in file field with glob(). A pattern matching nothing
+ * is kept as it is, so that job reports the missing file by itself.
+ */
+STATUS TargetExpander(IN const char* file, OUT char*** files_out, OUT int* size_o);
+
 /**
  * @brief WaitStatusChecker
  * 
@@ -119,30 +236,298 @@ STATUS CommandParser(IN const char* commands, IN const char* file, IN char*** ar
  */
 STATUS Worker(IN const char* command, IN const char* file, IN int order);
 
+/**
+ * @brief CacheWrite
+ * 
+ * @param buffer: output to append to cache
+ * @param size: size of output
+ * @return int: 0 if every byte is written, -1 otherwise, e.g. ENOSPC
+ * 
+ * The function will write output relayed by job process to its cache on stdout.
+ */
+int CacheWrite(const char* buffer, long size);
+
+/**
+ * @brief CacheRedirect
+ * 
+ * The function will redirect stdout and stderr of job process to cache 'job_{pid}_cache'.
+ */
+void CacheRedirect();
+
+/**
+ * @brief JobFile
+ * 
+ * @return const char*: target file of job, empty string if file field is blank
+ */
+const char* JobFile(JobMatrix* matrix, int job);
+
+/**
+ * @brief LocalLaunch
+ * 
+ * @param matrix: job matrix
+ * @param job: index of job to launch
+ * @return int: process id of job process
+ * 
+ * Local backend: the job process runs Worker(), which fork/exec the command on this host.
+ */
+int LocalLaunch(JobMatrix* matrix, int job);
+
+/**
+ * @brief RemoteLaunch
+ * 
+ * @param matrix: job matrix
+ * @param job: index of job to launch
+ * @return int: process id of job process
+ * 
+ * Remote backend: the job process runs RemoteWorker(), which ships the job to an agent. Jobs are
+ * spread over agents in round robin.
+ */
+int RemoteLaunch(JobMatrix* matrix, int job);
+
+/**
+ * @brief RemoteWorker
+ * 
+ * @param command: raw command string received from main process
+ * @param file: target file, empty if blank
+ * @param order: order of command
+ * @param firstAgent: agent to try first
+ * 
+ * The function will ship a job descriptor {token, command, file, order, force} to an agent and relay
+ * the output of the job into the local cache, so Reporter() merges it as a local job. An agent
+ * without the target file declines the job and the next agent is tried; the last agent is
+ * forced to run it and report the missing file. Status record of the remote job is routed back
+ * into status channel of this process.
+ */
+STATUS RemoteWorker(IN const char* command, IN const char* file, IN int order, IN int firstAgent);
+
+/**
+ * @brief FileListAppend
+ * 
+ * @param list: growing list of file names
+ * @param size: number of names in list
+ * @param capacity: number of names list has room for
+ * @param file: name to append, owned by list from now on
+ */
+void FileListAppend(char*** list, int* size, int* capacity, char* file);
+
+/**
+ * @brief RemoteExpander
+ * 
+ * @param file: raw file field, a list of files or glob patterns separated by spaces
+ * @param files_out: expanded file names
+ * @param size_o: size of files_out
+ * 
+ * The function will expand every glob pattern of file field on all agents and merge the files
+ * matched, so shards spread over nodes are listed by one pattern.
+ */
+STATUS RemoteExpander(IN const char* file, OUT char*** files_out, OUT int* size_o);
+
+/**
+ * @brief AgentExpand
+ * 
+ * @param fd: connection from a remote client
+ * 
+ * The function will expand a glob pattern in working directory of agent and send back the
+ * files it matches.
+ */
+STATUS AgentExpand(IN int fd);
+
+/**
+ * @brief AgentSession
+ * 
+ * @param fd: connection from a remote worker
+ * 
+ * The function will run one job for a remote worker: read job descriptor, run it with Worker()
+ * into a local cache, then send cache back in frames followed by status record. The job is killed
+ * if the remote worker goes away before it is done, e.g. cancelled by short-circuit policy.
+ */
+STATUS AgentSession(IN int fd);
+
+/**
+ * @brief Agent
+ * 
+ * @param port: TCP port to listen on, of options.agentAddress or loopback
+ * 
+ * The function will serve remote workers forever, one session process per connection. Only
+ * peers presenting the token of $MASH_TOKEN are served.
+ */
+STATUS Agent(IN int port);
+
+/**
+ * @brief InterruptHandler
+ * 
+ * @param sig: SIGINT, SIGTERM or SIGHUP delivered to main process
+ * 
+ * The function will terminate jobs not reaped yet with their commands and remove cache files,
+ * then re-raise the signal.
+ */
+void InterruptHandler(int sig);
+
+/**
+ * @brief Scheduler
+ * 
+ * @param matrix: job matrix to run
+ * 
+ * The function will run every job of matrix on a pool of at most options.maxJobs job processes.
+ * A new job is dispatched as soon as a running one is finished. Under a short-circuit policy,
+ * every job runs in its own process group and the first deciding job kills all the others.
+ */
+STATUS Scheduler(IN JobMatrix* matrix);
+
+/**
+ * @brief DispatchPlanner
+ * 
+ * @param matrix: job matrix, input size and expected runtime of every job are filled in
+ * @param history: runtime history, nullptr to keep input order
+ * @param plan: job indices in dispatch order
+ * 
+ * The function will order jobs longest-expected-first, so a long job does not start last and
+ * extend the makespan. Jobs never seen before go first, larger input first, since they may be
+ * the longest of all.
+ */
+STATUS DispatchPlanner(IN JobMatrix* matrix, IN History* history, OUT int* plan);
+
+/**
+ * @brief DispatchBefore
+ * 
+ * @return int: true if job 'a' should be dispatched before job 'b'
+ */
+int DispatchBefore(JobMatrix* matrix, int a, int b);
+
+/**
+ * @brief CacheNote
+ * 
+ * @param pid: process id of a finished job
+ * @param color: color of note
+ * @param note: one line note appended to cache of job
+ */
+void CacheNote(int pid, const char* color, const char* note);
+
+/**
+ * @brief ProgressWait
+ * 
+ * @param matrix: job matrix
+ * @param wstatus: wstatus of finished job
+ * @param progress: state of live dashboard
+ * @return int: process id of finished job, -1 on error
+ * 
+ * The function will wait any job to be done like wait(), redrawing live dashboard every
+ * PROGRESS_INTERVAL in the meantime. It sleeps on SIGCHLD, so a finished job is reaped at once.
+ */
+int ProgressWait(IN JobMatrix* matrix, OUT int* wstatus, IN Progress* progress);
+
+/**
+ * @brief FormatBytes
+ * 
+ * @param bytes: number of bytes
+ * @param out: human readable size, at least 16 bytes
+ */
+void FormatBytes(long bytes, char* out);
+
+/**
+ * @brief ProgressRender
+ * 
+ * @param matrix: job matrix
+ * @param progress: state of live dashboard
+ * 
+ * The function will draw live dashboard on stderr from result board: a summary line, then up to
+ * PROGRESS_MAX_ROWS running jobs, longest running first, so stragglers stay on top. Input read
+ * by a command comes from /proc/<pid>/io, read only for the rows shown.
+ */
+void ProgressRender(IN JobMatrix* matrix, IN Progress* progress);
+
+/**
+ * @brief ProgressClear
+ * 
+ * @param progress: state of live dashboard
+ * 
+ * The function will erase live dashboard before report is printed.
+ */
+void ProgressClear(IN Progress* progress);
+
+/**
+ * @brief PolicyDecides
+ * 
+ * @param statusCode: status code of a finished job
+ * @return int: true if the job decides outcome of the whole run under options.policy
+ */
+int PolicyDecides(int statusCode);
+
+/**
+ * @brief JobOrder
+ * 
+ * @param matrix: job matrix
+ * @param pid: process id of a job
+ * @return int: index of job in matrix, 0 if not found
+ */
+int JobOrder(JobMatrix* matrix, int pid);
+
+/**
+ * @brief RuntimeMeasured
+ * 
+ * @param matrix: job matrix
+ * @param job: index of job in matrix
+ * @return int: true if command of job ran to its end, with status 0 or a non-zero exit (248)
+ */
+int RuntimeMeasured(JobMatrix* matrix, int job);
+
+/**
+ * @brief CacheTotal
+ * 
+ * @param cacheName: cache file of a job
+ * @param bytes: bytes of output written by command
+ * @param file: target file of the job, nullptr if none
+ * @param total: sum of counts found in output
+ * @return int: true if every output line is a bare number or a number followed by target file
+ */
+int CacheTotal(const char* cacheName, long bytes, const char* file, long* total);
+
+/**
+ * @brief WaitStatusParser
+ * 
+ * @param pid: process id of a finished job
+ * @param wstatus: wstatus of the job
+ * @param matrix: job matrix the job belongs to
+ * 
+ * The function will report a finished job and record its status code in matrix.
+ */
+void WaitStatusParser(int pid, int wstatus, JobMatrix* matrix);
+
+/**
+ * @brief CompareReport
+ * 
+ * @param matrix: job matrix
+ * @param f: index of target file
+ * 
+ * The function will group commands run on target file by digest of their output, then print a
+ * line-level diff of every other group against the first one. Only jobs whose command ran are
+ * compared, whatever its exit status. Caches are streamed, never loaded as a whole.
+ */
+void CompareReport(IN JobMatrix* matrix, IN int f);
+
 /**
  * @brief Reporter
  * 
- * @param jobQueue: job with process id in order
- * @param statusQueue: status code responding to jobQueue
+ * @param matrix: job matrix with process id and status code of every job
  * @param runtimeMain: run time for main process
  * @param file: target file
  * @return STATUS: 0 for success
  * 
  * The function will generate summary report.
- * 1. detailed report is generated by a new process.
- * 2. summary is written to stdout.
+ * 1. detailed report is generated by a new process, grouped per command and per file.
+ * 2. summary is written to stdout, with totals per command when mashed over several files.
  */
-STATUS Reporter(int* jobQueue, int* statusQueue, double runtimeMain, char* file);
+STATUS Reporter(JobMatrix* matrix, double runtimeMain, char* file);
 
 /**
  * @brief Cleaner
  * 
- * @param jobQueue: jobs with process ID in order 
+ * @param matrix: jobs with process ID in order 
  * @return STATUS: 0 for success
  * 
  * The function will clean cache file generated by worker processes
  */
-STATUS Cleaner(int* jobQueue);
+STATUS Cleaner(JobMatrix* matrix);
 
 /**
  * @brief isCommandWithTarget
@@ -0,0 +1,76 @@
+#include "mashboard.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+/**
+ * @brief board_create
+ * 
+ * @param numberOfSlots: number of jobs
+ * @return JobSlot*: zeroed slots in a shared mapping, NULL on failure
+ * 
+ * Must be called before forking jobs, so the board is shared by main process and every job.
+ */
+JobSlot* board_create(int numberOfSlots) {
+    size_t size = sizeof(JobSlot) * (numberOfSlots > 0 ? numberOfSlots : 1);
+    void* board = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (board == MAP_FAILED) {
+        return NULL;
+    }
+    return board;
+}
+
+void board_destroy(JobSlot* board, int numberOfSlots) {
+    if (board != NULL) {
+        munmap(board, sizeof(JobSlot) * (numberOfSlots > 0 ? numberOfSlots : 1));
+    }
+}
+
+/**
+ * @brief board_now
+ * 
+ * @return long: microseconds since epoch
+ */
+long board_now() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec * 1000000L + now.tv_usec;
+}
+
+/**
+ * @brief board_set_state
+ * 
+ * Publish new state, every field written before is visible to a reader seeing the state.
+ */
+void board_set_state(JobSlot* slot, int state) {
+    if (slot != NULL) {
+        __atomic_store_n(&slot->state, state, __ATOMIC_RELEASE);
+    }
+}
+
+int board_state(JobSlot* slot) {
+    return __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief board_progress
+ * 
+ * @param slot: slot of this job, may be NULL
+ * @param buffer: output just relayed
+ * @param size: size of buffer
+ * 
+ * Account relayed output. Only the job writes these fields, so plain atomic stores are enough.
+ */
+void board_progress(JobSlot* slot, const char* buffer, long size) {
+    if (slot == NULL) {
+        return;
+    }
+    long lines = 0;
+    for (const char* p = buffer; (p = memchr(p, '\n', buffer + size - p)) != NULL; p++) {
+        lines++;
+    }
+    __atomic_store_n(&slot->bytes, slot->bytes + size, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->lines, slot->lines + lines, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->lastActivity, board_now(), __ATOMIC_RELAXED);
+}
@@ -0,0 +1,42 @@
+#ifndef MASHBOARD_H
+#define MASHBOARD_H
+
+#include "masherror.h"
+
+#define BOARD_LINE_SIZE 64 // cache line
+
+// state of a slot, only moves forward
+#define SLOT_PENDING 0      // job not dispatched yet
+#define SLOT_STARTED 1      // job process is up
+#define SLOT_RUNNING 2      // command is executing, output is being relayed
+#define SLOT_DONE 3         // final status is published
+#define SLOT_CANCELLED 4    // job is killed or never dispatched, set by main process
+
+/**
+ * @brief JobSlot
+ * 
+ * Fixed-layout slot of a job on result board. A slot has a single writer: the job process while
+ * it runs, main process once the job is reaped. Progress fields sit in the first cache line and
+ * final status in the second, so readers polling progress never share a line with the status
+ * being published. Readers load 'state' with acquire and then read the fields it guards.
+ */
+typedef struct JobSlot {
+    int state;              // SLOT_*
+    int pid;                // job process
+    int execPid;            // command process, 0 before fork
+    int padding;
+    long startTime;         // job start, microseconds since epoch
+    long lastActivity;      // last output relayed, microseconds since epoch
+    long bytes;             // bytes of output relayed so far
+    long lines;             // lines of output relayed so far
+    JobStatus status __attribute__((aligned(BOARD_LINE_SIZE))); // valid once state is SLOT_DONE
+} __attribute__((aligned(BOARD_LINE_SIZE))) JobSlot;
+
+JobSlot* board_create(int numberOfSlots);
+void board_destroy(JobSlot* board, int numberOfSlots);
+long board_now();
+void board_set_state(JobSlot* slot, int state);
+int board_state(JobSlot* slot);
+void board_progress(JobSlot* slot, const char* buffer, long size);
+
+#endif
@@ -0,0 +1,229 @@
+#include "mashcompare.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
+
+static FILE* compare_open(const char* cacheName) {
+    // output of command starts right after header line of cache
+    FILE* cache = fopen(cacheName, "r");
+    if (cache == NULL) {
+        return NULL;
+    }
+    int c;
+    while (((c = getc(cache)) != EOF) && (c != '\n')) {
+    }
+    return cache;
+}
+
+/**
+ * @brief compare_digest
+ *
+ * @param cacheName: cache file of job
+ * @param bytes: bytes of output written by command, as counted while relaying
+ * @param digest: digest to fill
+ * @return int: 0 for success, -1 if cache cannot be read
+ *
+ * Output is hashed in chunks as it is read, so memory use does not depend on output size.
+ */
+int compare_digest(const char* cacheName, long bytes, CompareDigest* digest) {
+    FILE* cache = compare_open(cacheName);
+    if (cache == NULL) {
+        return -1;
+    }
+    digest->hash = FNV_OFFSET;
+    digest->bytes = 0;
+    digest->lines = 0;
+    unsigned char buffer[COMPARE_BUFFER_SIZE];
+    while (digest->bytes < bytes) {
+        long want = bytes - digest->bytes;
+        size_t n = fread(buffer, 1, (want < COMPARE_BUFFER_SIZE) ? want : COMPARE_BUFFER_SIZE, cache);
+        if (n == 0) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            digest->hash = (digest->hash ^ buffer[i]) * FNV_PRIME;
+            if (buffer[i] == '\n') {
+                digest->lines++;
+            }
+        }
+        digest->bytes += n;
+    }
+    fclose(cache);
+    return 0;
+}
+
+static int compare_read_line(CompareStream* stream, CompareLine* line) {
+    if (stream->remaining <= 0) {
+        return 0;
+    }
+    line->hash = FNV_OFFSET;
+    line->truncated = 0;
+    int size = 0;
+    int c = 0;
+    while ((stream->remaining > 0) && ((c = getc(stream->file)) != EOF)) {
+        stream->remaining--;
+        if (c == '\n') {
+            break;
+        }
+        line->hash = (line->hash ^ (unsigned char)c) * FNV_PRIME;
+        if (size < COMPARE_LINE_SIZE - 1) {
+            line->text[size++] = c;
+        }
+        else {
+            line->truncated = 1;
+        }
+    }
+    if (c == EOF) {
+        stream->remaining = 0;
+    }
+    line->text[size] = '\0';
+    line->number = ++stream->lines;
+    return 1;
+}
+
+static CompareLine* compare_at(CompareStream* stream, int k) {
+    return &stream->window[(stream->head + k) % COMPARE_WINDOW];
+}
+
+static void compare_fill(CompareStream* stream) {
+    while ((stream->count < COMPARE_WINDOW) && compare_read_line(stream, compare_at(stream, stream->count))) {
+        stream->count++;
+    }
+}
+
+static void compare_pop(CompareStream* stream, int n) {
+    stream->head = (stream->head + n) % COMPARE_WINDOW;
+    stream->count -= n;
+}
+
+static long compare_find(CompareStream* stream, unsigned long hash) {
+    // lines before first line hashing to 'hash' past window, scanned without buffering, -1 if none
+    long position = ftell(stream->file);
+    long remaining = stream->remaining;
+    long found = -1;
+    unsigned long h = FNV_OFFSET;
+    int c;
+    for (long n = stream->count; (n < stream->count + COMPARE_LOOKAHEAD) && (remaining > 0) &&
+        ((c = getc(stream->file)) != EOF); remaining--) {
+        if (c != '\n') {
+            h = (h ^ (unsigned char)c) * FNV_PRIME;
+            continue;
+        }
+        if (h == hash) {
+            found = n;
+            break;
+        }
+        h = FNV_OFFSET;
+        n++;
+    }
+    fseek(stream->file, position, SEEK_SET);
+    return found;
+}
+
+static long compare_position(CompareStream* stream) {
+    // line number of first line in window, or of last line read if window is empty
+    return (stream->count > 0) ? compare_at(stream, 0)->number : stream->lines;
+}
+
+static long compare_print(FILE* out, CompareStream* stream, int n, char sign, int* budget) {
+    long shown = 0;
+    for (int k = 0; (k < n) && (*budget > 0); k++, (*budget)--, shown++) {
+        CompareLine* line = compare_at(stream, k);
+        fprintf(out, "%c %s%s\n", sign, line->text, line->truncated ? "..." : "");
+    }
+    return shown;
+}
+
+/**
+ * @brief compare_diff
+ *
+ * @param cacheA: cache file of first job
+ * @param bytesA: bytes of output of first job
+ * @param cacheB: cache file of second job
+ * @param bytesB: bytes of output of second job
+ * @param out: stream diff is written to, at most COMPARE_MAX_LINES lines
+ * @return long: number of differing lines, -1 if a cache cannot be read
+ *
+ * Outputs are streamed side by side, holding at most COMPARE_WINDOW lines of each. Equal lines
+ * are skipped; on a difference, the closest pair of equal lines within both windows is taken as
+ * resynchronization point and lines before it are reported as a hunk. If windows share no line,
+ * up to COMPARE_LOOKAHEAD lines past each window are scanned for the line the other side is at,
+ * and the window of the side found to have extra lines is reported as added or removed, so an
+ * insertion longer than a window is caught up with. If neither is found, both windows are
+ * reported as changed. Result is a line-level diff like diff(1) for local changes, but may be
+ * longer than minimal when a change spans more than a window.
+ */
+long compare_diff(const char* cacheA, long bytesA, const char* cacheB, long bytesB, FILE* out) {
+    CompareStream* a = calloc(1, sizeof(CompareStream));
+    CompareStream* b = calloc(1, sizeof(CompareStream));
+    a->file = compare_open(cacheA);
+    b->file = compare_open(cacheB);
+    a->remaining = bytesA;
+    b->remaining = bytesB;
+    long changed = -1;
+    if ((a->file == NULL) || (b->file == NULL)) {
+        goto done;
+    }
+
+    changed = 0;
+    long shown = 0;
+    int budget = COMPARE_MAX_LINES;
+    while (1) {
+        compare_fill(a);
+        compare_fill(b);
+        if ((a->count == 0) && (b->count == 0)) {
+            break;
+        }
+        if ((a->count > 0) && (b->count > 0) && (compare_at(a, 0)->hash == compare_at(b, 0)->hash)) {
+            compare_pop(a, 1);
+            compare_pop(b, 1);
+            continue;
+        }
+
+        // closest resynchronization point (i, j) by i + j
+        int removed = -1;
+        int added = -1;
+        for (int s = 1; (s <= a->count + b->count - 2) && (removed == -1); s++) {
+            for (int i = (s < b->count) ? 0 : s - b->count + 1; (i <= s) && (i < a->count); i++) {
+                if (compare_at(a, i)->hash == compare_at(b, s - i)->hash) {
+                    removed = i;
+                    added = s - i;
+                    break;
+                }
+            }
+        }
+        if (removed == -1) {
+            // none within windows, side the other's head shows up in past its window has extra lines
+            long inB = (a->count > 0) ? compare_find(b, compare_at(a, 0)->hash) : -1;
+            long inA = (b->count > 0) ? compare_find(a, compare_at(b, 0)->hash) : -1;
+            removed = ((inB != -1) && ((inA == -1) || (inB <= inA))) ? 0 : a->count;
+            added = ((inA != -1) && ((inB == -1) || (inA < inB))) ? 0 : b->count;
+        }
+
+        if (budget > 0) {
+            fprintf(out, "@@ -%ld,%d +%ld,%d @@\n", compare_position(a), removed, compare_position(b), added);
+            budget--;
+            shown += compare_print(out, a, removed, '-', &budget);
+            shown += compare_print(out, b, added, '+', &budget);
+        }
+        changed += removed + added;
+        compare_pop(a, removed);
+        compare_pop(b, added);
+    }
+    if (shown < changed) {
+        fprintf(out, "... %ld more differing lines\n", changed - shown);
+    }
+
+done:
+    if (a->file != NULL) {
+        fclose(a->file);
+    }
+    if (b->file != NULL) {
+        fclose(b->file);
+    }
+    free(a);
+    free(b);
+    return changed;
+}
@@ -0,0 +1,52 @@
+#ifndef MASHCOMPARE_H
+#define MASHCOMPARE_H
+
+#include <stdio.h>
+
+#define COMPARE_BUFFER_SIZE 65536
+#define COMPARE_WINDOW 64       // lines buffered per side to resynchronize after a difference
+#define COMPARE_LINE_SIZE 160   // characters of a line kept for display, whole line is hashed
+#define COMPARE_MAX_LINES 24    // diff lines printed per pair of outputs
+#define COMPARE_LOOKAHEAD 4096  // lines scanned past window for a line the other side is at
+
+/**
+ * @brief CompareDigest
+ *
+ * Fingerprint of output of a job: FNV-1a hash over all bytes, with its size and line count.
+ */
+typedef struct {
+    unsigned long hash;
+    long bytes;
+    long lines;
+} CompareDigest;
+
+/**
+ * @brief CompareLine
+ *
+ * A line of output in diff window, compared by hash of whole line.
+ */
+typedef struct {
+    unsigned long hash;
+    long number;                        // 1-based line number in output
+    int truncated;                      // true if text holds only a prefix of line
+    char text[COMPARE_LINE_SIZE];
+} CompareLine;
+
+/**
+ * @brief CompareStream
+ *
+ * Output of a job inside its cache file: bytes right after header line, 'remaining' long.
+ */
+typedef struct {
+    FILE* file;
+    long remaining;
+    long lines;                         // lines read so far
+    int count;                          // lines in window
+    int head;                           // first line of window
+    CompareLine window[COMPARE_WINDOW];
+} CompareStream;
+
+int compare_digest(const char* cacheName, long bytes, CompareDigest* digest);
+long compare_diff(const char* cacheA, long bytesA, const char* cacheB, long bytesB, FILE* out);
+
+#endif
@@ -1,40 +1,125 @@
 #include "masherror.h"
+#include "mashboard.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// status channel of this job process: its slot on result board, NULL if none or already emitted
+static JobSlot* statusSlot = NULL;
+static JobStatus status;
+
+/**
+ * @brief status_channel_open
+ * 
+ * @param slot: slot of this job on result board
+ * @param job: index of job in job matrix
+ * 
+ * Called in job process before it does anything, so every exception below reports into it.
+ */
+void status_channel_open(JobSlot* slot, int job) {
+    statusSlot = slot;
+    memset(&status, 0, sizeof(status));
+    status.job = job;
+    status.pid = getpid();
+    status.waitStatus = -1;
+    if (slot != NULL) {
+        slot->pid = status.pid;
+        slot->startTime = board_now();
+        board_set_state(slot, SLOT_STARTED);
+    }
+}
+
+/**
+ * @brief status_channel_record
+ * 
+ * @return JobStatus*: record of this job process to be filled before status_channel_emit()
+ */
+JobStatus* status_channel_record() {
+    return &status;
+}
+
+/**
+ * @brief status_channel_slot
+ * 
+ * @return JobSlot*: slot of this job for progress updates, NULL if none
+ */
+JobSlot* status_channel_slot() {
+    return statusSlot;
+}
+
+/**
+ * @brief status_channel_emit
+ * 
+ * @param mashCode: MASH status code of job
+ * 
+ * Publish the record into slot once; stdout is flushed first so main never sees a final status
+ * before the output it describes is in cache.
+ */
+void status_channel_emit(int mashCode) {
+    fflush(stdout);
+    if (statusSlot == NULL) {
+        return;
+    }
+    status.mashCode = mashCode;
+    statusSlot->status = status;
+    board_set_state(statusSlot, SLOT_DONE);
+    statusSlot = NULL;
+}
 
 void process_pipe_exception() {
     printf("Error: failed to initialize a pipe communication.\n");
+    status_channel_emit(PROCESS_PIPE_ERROR);
     exit(PROCESS_PIPE_ERROR);
 }
 
 void process_allocation_exception() {
     printf("Error: failed to allocate a new process.\n");
+    status_channel_emit(PROCESS_ALLOCATION_ERROR);
     exit(PROCESS_ALLOCATION_ERROR);
 }
 
 void process_wait_exception() {
     printf("Error: failed to wait child process to be done.\n");
+    status_channel_emit(PROCESS_WAIT_ERROR);
     exit(PROCESS_WAIT_ERROR);
 }
 
 void process_execvp_exception(const char* command) {
     printf("\n%s[Failure]: command '%s' is not found or can not be executed properly.\n%s", KRED, command, RESET);
+    status_channel_emit(PROCESS_EXECVP_ERROR);
     exit(PROCESS_EXECVP_ERROR);
 }
 
-void process_command_usage_exception(const char* command) {
-    printf("\n%s[Failure]: wrong usage of command '%s'.\n%s", KRED, command, RESET);
-    exit(PROCESS_COMMAND_USAGE_ERROR);
-}
-
 void process_command_exception(const char* command) {
     printf("\n%s[Failure]: '%s' needs target file or target file can not be opened.\n%s", KRED, command, RESET);
+    status_channel_emit(PROCESS_COMMAND_ERROR);
     exit(PROCESS_COMMAND_ERROR);
 }
 
-void process_file_directory_exception() {
-    printf("\n%s[Failure]: no such file or directory.\n%s", KRED, RESET);
-    exit(PROCESS_FILE_DIRECTORY_ERROR);
+void process_remote_exception(const char* agent) {
+    printf("\n%s[Failure]: failed to run job on remote agent '%s'.\n%s", KRED, agent, RESET);
+    status_channel_emit(PROCESS_REMOTE_ERROR);
+    exit(PROCESS_REMOTE_ERROR);
+}
+
+void process_command_status_exception(const char* command, int wstatus) {
+    if (WIFSIGNALED(wstatus)) {
+        printf("\n%s[Failure]: command '%s' is killed by signal %d (%s).\n%s", 
+               KRED, command, WTERMSIG(wstatus), strsignal(WTERMSIG(wstatus)), RESET);
+    }
+    else {
+        printf("\n%s[Failure]: command '%s' exited with status %d.\n%s", KRED, command, WEXITSTATUS(wstatus), RESET);
+    }
+    status_channel_emit(PROCESS_COMMAND_STATUS_ERROR);
+    exit(PROCESS_COMMAND_STATUS_ERROR);
+}
+
+void process_cache_exception() {
+    printf("\n%s[Failure]: output of command can not be written to cache.\n%s", KRED, RESET);
+    status_channel_emit(PROCESS_CACHE_ERROR);
+    exit(PROCESS_CACHE_ERROR);
 }
 
 void process_no_command_warning(int order) {
@@ -45,5 +130,6 @@ void process_no_command_warning(int order) {
     printf("\n");
     printf("\n");
     printf("%s[Warning]: no input from command line.\n%s", KBLU, RESET);
+    status_channel_emit(PROCESS_NO_COMMAND_WARNING);
     exit(PROCESS_NO_COMMAND_WARNING);
 }
@@ -7,10 +7,14 @@
 #define PROCESS_ALLOCATION_ERROR 241
 #define PROCESS_WAIT_ERROR 242
 #define PROCESS_EXECVP_ERROR 243
-#define PROCESS_COMMAND_USAGE_ERROR 244
+#define PROCESS_COMMAND_USAGE_ERROR 244    // retired, replaced by 248
 #define PROCESS_COMMAND_ERROR 245
-#define PROCESS_FILE_DIRECTORY_ERROR 246
+#define PROCESS_FILE_DIRECTORY_ERROR 246   // retired, replaced by 248
+#define PROCESS_REMOTE_ERROR 247
+#define PROCESS_COMMAND_STATUS_ERROR 248
+#define PROCESS_CACHE_ERROR 249
 #define PROCESS_NO_COMMAND_WARNING 124
+#define PROCESS_CANCELLED_WARNING 125
 
 #define KRED "\x1B[31m"
 #define KGRN "\x1B[32m"
@@ -18,13 +22,40 @@
 #define KBLU "\x1B[34m"
 #define RESET "\033[0m"
 
+/**
+ * @brief JobStatus
+ * 
+ * Status record a job process publishes to main process through status channel, instead of
+ * squeezing everything into 8 bits of exit code.
+ */
+typedef struct {
+    int job;                // index of job in job matrix, -1 if unknown
+    int pid;                // job process
+    int mashCode;           // MASH status code, 0 for success
+    int execErrno;          // errno of failed execvp(), 0 if command was executed
+    int waitStatus;         // raw wait status of command, -1 if command never ran
+    int signal;             // signal terminating command, 0 if none
+    long startTime;         // command start, microseconds since epoch, 0 if never ran
+    long endTime;           // command end, microseconds since epoch, 0 if never ran
+    long bytes;             // bytes of output produced by command
+    long lines;             // lines of output produced by command
+} JobStatus;
+
+struct JobSlot;
+
+void status_channel_open(struct JobSlot* slot, int job);
+JobStatus* status_channel_record();
+struct JobSlot* status_channel_slot();
+void status_channel_emit(int mashCode);
+
 void process_pipe_exception(); // 240
 void process_allocation_exception(); // 241
 void process_wait_exception(); // 242
 void process_execvp_exception(const char* command); // 243
-void process_command_usage_exception(const char* command); // 244
 void process_command_exception(const char* command); // 245
-void process_file_directory_exception(); // 246
+void process_remote_exception(const char* agent); // 247
+void process_command_status_exception(const char* command, int wstatus); // 248
+void process_cache_exception(); // 249
 
 void process_no_command_warning(int order); // 124
 
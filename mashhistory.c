@@ -0,0 +1,169 @@
+#include "mashhistory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static unsigned long history_key(const char* command) {
+    // FNV-1a over tokens joined by a single space, so spacing does not change the key
+    unsigned long hash = 14695981039346656037UL;
+    int started = 0;
+    int separator = 0;
+    for (const char* p = command; *p != '\0'; p++) {
+        if ((*p == ' ') || (*p == '\t')) {
+            separator = 1;
+            continue;
+        }
+        if (separator && started) {
+            hash = (hash ^ ' ') * 1099511628211UL;
+        }
+        started = 1;
+        separator = 0;
+        hash = (hash ^ (unsigned char)*p) * 1099511628211UL;
+    }
+    return hash;
+}
+
+static int history_bucket(long bytes) {
+    int bucket = 0;
+    while (bytes > 0) {
+        bucket++;
+        bytes >>= 1;
+    }
+    return bucket;
+}
+
+/**
+ * @brief history_load
+ * 
+ * @param history: history to fill
+ * @param path: history file, a missing or corrupt file gives an empty history
+ */
+void history_load(History* history, const char* path) {
+    snprintf(history->path, HISTORY_PATH_SIZE, "%s", path);
+    history->size = 0;
+    history->stamp = 1;
+    FILE* in = fopen(path, "r");
+    if (in == NULL) {
+        return;
+    }
+    char line[256];
+    while ((history->size < HISTORY_MAX_RECORDS) && (fgets(line, sizeof(line), in) != NULL)) {
+        HistoryRecord* record = &history->records[history->size];
+        if (sscanf(line, "%lx %d %d %ld %ld %ld", &record->key, &record->bucket, &record->samples,
+                   &record->bytes, &record->runtime, &record->stamp) != 6) {
+            continue; // comment or corrupt line
+        }
+        if (record->stamp >= history->stamp) {
+            history->stamp = record->stamp + 1;
+        }
+        history->size++;
+    }
+    fclose(in);
+}
+
+/**
+ * @brief history_predict
+ * 
+ * @param history: history
+ * @param command: command string without target file
+ * @param bytes: size of target file
+ * @return long: expected runtime in microseconds, -1 if command is never seen
+ * 
+ * The record of the same size bucket is preferred, otherwise the nearest bucket is used. Runtime
+ * is scaled linearly from the average input size of record to given size.
+ */
+long history_predict(History* history, const char* command, long bytes) {
+    unsigned long key = history_key(command);
+    int bucket = history_bucket(bytes);
+    HistoryRecord* best = NULL;
+    for (int i = 0; i < history->size; i++) {
+        HistoryRecord* record = &history->records[i];
+        if (record->key != key) {
+            continue;
+        }
+        if ((best == NULL) || (abs(record->bucket - bucket) < abs(best->bucket - bucket))) {
+            best = record;
+        }
+    }
+    if (best == NULL) {
+        return -1;
+    }
+    if ((best->bytes > 0) && (bytes > 0)) {
+        return (long)((double)best->runtime * bytes / best->bytes);
+    }
+    return best->runtime;
+}
+
+/**
+ * @brief history_update
+ * 
+ * @param history: history
+ * @param command: command string without target file
+ * @param bytes: size of target file
+ * @param runtime: measured runtime in microseconds
+ */
+void history_update(History* history, const char* command, long bytes, long runtime) {
+    unsigned long key = history_key(command);
+    int bucket = history_bucket(bytes);
+    HistoryRecord* record = NULL;
+    for (int i = 0; i < history->size; i++) {
+        if ((history->records[i].key == key) && (history->records[i].bucket == bucket)) {
+            record = &history->records[i];
+            break;
+        }
+    }
+    if (record == NULL) {
+        if (history->size < HISTORY_MAX_RECORDS) {
+            record = &history->records[history->size++];
+        }
+        else {
+            record = &history->records[0];
+            for (int i = 1; i < history->size; i++) {
+                if (history->records[i].stamp < record->stamp) {
+                    record = &history->records[i];
+                }
+            }
+        }
+        record->key = key;
+        record->bucket = bucket;
+        record->samples = 0;
+    }
+    if (record->samples == 0) {
+        record->bytes = bytes;
+        record->runtime = runtime;
+    }
+    else {
+        record->bytes = (long)(HISTORY_WEIGHT * bytes + (1 - HISTORY_WEIGHT) * record->bytes);
+        record->runtime = (long)(HISTORY_WEIGHT * runtime + (1 - HISTORY_WEIGHT) * record->runtime);
+    }
+    record->samples++;
+    record->stamp = history->stamp;
+}
+
+/**
+ * @brief history_save
+ * 
+ * @param history: history to write back to its file
+ * 
+ * History is written to a temporary file first and renamed, so a concurrent mash never reads
+ * a half written file.
+ */
+void history_save(History* history) {
+    char tempName[HISTORY_PATH_SIZE + 16];
+    snprintf(tempName, sizeof(tempName), "%s.%d", history->path, getpid());
+    FILE* out = fopen(tempName, "w");
+    if (out == NULL) {
+        return;
+    }
+    fprintf(out, "# mash history: key bucket samples bytes runtime(us) stamp\n");
+    for (int i = 0; i < history->size; i++) {
+        HistoryRecord* record = &history->records[i];
+        fprintf(out, "%lx %d %d %ld %ld %ld\n", record->key, record->bucket, record->samples,
+                record->bytes, record->runtime, record->stamp);
+    }
+    fclose(out);
+    if (rename(tempName, history->path) == -1) {
+        unlink(tempName);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef MASHHISTORY_H
+#define MASHHISTORY_H
+
+#define HISTORY_MAX_RECORDS 1024
+#define HISTORY_PATH_SIZE 4096
+#define HISTORY_WEIGHT 0.3 // weight of newest sample in moving average
+
+/**
+ * @brief HistoryRecord
+ * 
+ * Runtime of a command over inputs of similar size. Records are keyed by hash of argv (without
+ * target file) and log2 bucket of input size.
+ */
+typedef struct {
+    unsigned long key;      // FNV-1a hash of normalized command
+    int bucket;             // log2 of input size
+    int samples;            // number of runs averaged
+    long bytes;             // moving average of input size in bytes
+    long runtime;           // moving average of runtime in microseconds
+    long stamp;             // run in which record was last updated, oldest is evicted first
+} HistoryRecord;
+
+typedef struct {
+    char path[HISTORY_PATH_SIZE];
+    int size;
+    long stamp;
+    HistoryRecord records[HISTORY_MAX_RECORDS];
+} History;
+
+void history_load(History* history, const char* path);
+long history_predict(History* history, const char* command, long bytes);
+void history_update(History* history, const char* command, long bytes, long runtime);
+void history_save(History* history);
+
+#endif
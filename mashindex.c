@@ -0,0 +1,417 @@
+#define _GNU_SOURCE // timegm()
+#include "mashindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define FNV_OFFSET 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
+#define INDEX_MAX_TOKENS 16 // tokens of a query checked against bloom filters
+
+static int index_is_word(int c) {
+    return isalnum((unsigned char)c) || (c == '_');
+}
+
+static unsigned long index_hash(const char* token, size_t length) {
+    unsigned long hash = FNV_OFFSET;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)token[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static unsigned long index_mix(unsigned long hash) {
+    // finalizer of MurmurHash3, FNV-1a alone leaves low bits of similar tokens correlated
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdUL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53UL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static void index_bloom_add(IndexBlock* block, unsigned long hash) {
+    // double hashing, bit i is h1 + i * h2
+    hash = index_mix(hash);
+    unsigned long step = (hash >> 32) | 1;
+    for (int i = 0; i < INDEX_BLOOM_HASHES; i++) {
+        unsigned long bit = (hash + i * step) % INDEX_BLOOM_BITS;
+        block->bloom[bit / 64] |= 1UL << (bit % 64);
+    }
+}
+
+static int index_bloom_test(IndexBlock* block, unsigned long hash) {
+    hash = index_mix(hash);
+    unsigned long step = (hash >> 32) | 1;
+    for (int i = 0; i < INDEX_BLOOM_HASHES; i++) {
+        unsigned long bit = (hash + i * step) % INDEX_BLOOM_BITS;
+        if ((block->bloom[bit / 64] & (1UL << (bit % 64))) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static long index_mtime(struct stat* st) {
+    return st->st_mtim.tv_sec * 1000000000L + st->st_mtim.tv_nsec;
+}
+
+static int index_fingerprint(FILE* in, long end, unsigned long* headHash, unsigned long* tailHash) {
+    // hash first and last bytes of indexed region [0, end), cheap check that target is only appended
+    char buffer[(INDEX_HEAD_SIZE > INDEX_TAIL_SIZE) ? INDEX_HEAD_SIZE : INDEX_TAIL_SIZE];
+    long headSize = (end < INDEX_HEAD_SIZE) ? end : INDEX_HEAD_SIZE;
+    if ((fseeko(in, 0, SEEK_SET) == -1) || (fread(buffer, 1, headSize, in) != (size_t)headSize)) {
+        return -1;
+    }
+    *headHash = index_hash(buffer, headSize);
+    long start = (end > INDEX_TAIL_SIZE) ? end - INDEX_TAIL_SIZE : 0;
+    if ((fseeko(in, start, SEEK_SET) == -1) || (fread(buffer, 1, end - start, in) != (size_t)(end - start))) {
+        return -1;
+    }
+    *tailHash = index_hash(buffer, end - start);
+    return 0;
+}
+
+/**
+ * @brief index_timestamp
+ *
+ * @param line: line of target file
+ * @return long: leading timestamp of line in seconds since epoch (UTC), -1 if it has none
+ *
+ * Two forms are recognized at start of line: ISO 8601 'YYYY-MM-DD HH:MM:SS' (or with 'T'), and
+ * seconds since epoch with 9 or 10 digits, as written by most loggers.
+ */
+long index_timestamp(const char* line) {
+    if (!isdigit((unsigned char)line[0])) {
+        return -1;
+    }
+    if (isdigit((unsigned char)line[1]) && isdigit((unsigned char)line[2]) && 
+        isdigit((unsigned char)line[3]) && (line[4] == '-')) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        char separator;
+        if ((sscanf(line, "%4d-%2d-%2d%c%2d:%2d:%2d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &separator,
+                    &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 7) || ((separator != ' ') && (separator != 'T'))) {
+            return -1;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        return timegm(&tm);
+    }
+    char* end;
+    long seconds = strtol(line, &end, 10);
+    if ((end - line < 9) || (end - line > 10) || isdigit((unsigned char)*end)) {
+        return -1;
+    }
+    return seconds;
+}
+
+static int index_append(Index* index) {
+    if (index->header.numberOfBlocks == index->capacity) {
+        int capacity = (index->capacity == 0) ? 64 : index->capacity * 2;
+        IndexBlock* blocks = realloc(index->blocks, sizeof(IndexBlock) * capacity);
+        if (blocks == NULL) {
+            return -1;
+        }
+        index->blocks = blocks;
+        index->capacity = capacity;
+    }
+    return index->header.numberOfBlocks++;
+}
+
+static int index_build(Index* index, FILE* in, long offset) {
+    // index lines from offset to end of file, offset is start of a block
+    if (fseeko(in, offset, SEEK_SET) == -1) {
+        return -1;
+    }
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int lineInBlock = 0;
+    IndexBlock* block = NULL;
+    while ((length = getline(&line, &capacity, in)) != -1) {
+        if (lineInBlock == 0) {
+            int b = index_append(index);
+            if (b == -1) {
+                free(line);
+                return -1;
+            }
+            block = &index->blocks[b];
+            memset(block, 0, sizeof(IndexBlock));
+            block->offset = offset;
+            block->minTime = LONG_MAX;
+            block->maxTime = LONG_MIN;
+        }
+        for (ssize_t i = 0; i < length; ) {
+            if (!index_is_word(line[i])) {
+                i++;
+                continue;
+            }
+            ssize_t start = i;
+            while ((i < length) && index_is_word(line[i])) {
+                i++;
+            }
+            index_bloom_add(block, index_hash(line + start, i - start));
+        }
+        long time = index_timestamp(line);
+        if (time != -1) {
+            block->minTime = (time < block->minTime) ? time : block->minTime;
+            block->maxTime = (time > block->maxTime) ? time : block->maxTime;
+        }
+        offset += length;
+        lineInBlock = (lineInBlock + 1) % index->header.blockLines;
+    }
+    free(line);
+    index->header.size = offset;
+    return index_fingerprint(in, offset, &index->header.headHash, &index->header.tailHash);
+}
+
+/**
+ * @brief index_load
+ *
+ * @param index: index to fill
+ * @param file: target file
+ * @param blockLines: lines per block
+ * @return int: 0 if sidecar is valid as is, 1 if index is built or extended and should be saved,
+ *              -1 if target file cannot be read
+ *
+ * A sidecar of other block size, or whose target is changed other than by appending, is rebuilt.
+ */
+int index_load(Index* index, const char* file, int blockLines) {
+    snprintf(index->path, INDEX_PATH_SIZE, "%s%s", file, INDEX_SUFFIX);
+    memset(&index->header, 0, sizeof(IndexHeader));
+    index->blocks = NULL;
+    index->capacity = 0;
+    struct stat st;
+    FILE* in = fopen(file, "r");
+    if ((in == NULL) || (fstat(fileno(in), &st) == -1)) {
+        if (in != NULL) {
+            fclose(in);
+        }
+        return -1;
+    }
+
+    // TODO: read sidecar, a corrupt sidecar gives an empty index
+    FILE* sidecar = fopen(index->path, "r");
+    if (sidecar != NULL) {
+        IndexHeader header;
+        if ((fread(&header, sizeof(header), 1, sidecar) == 1) && (memcmp(header.magic, INDEX_MAGIC, 8) == 0) &&
+            (header.blockLines == blockLines) && (header.numberOfBlocks >= 0)) {
+            index->blocks = malloc(sizeof(IndexBlock) * (header.numberOfBlocks + 1));
+            index->capacity = header.numberOfBlocks + 1;
+            if ((index->blocks != NULL) &&
+                (fread(index->blocks, sizeof(IndexBlock), header.numberOfBlocks, sidecar) == (size_t)header.numberOfBlocks)) {
+                index->header = header;
+            }
+        }
+        fclose(sidecar);
+    }
+    if ((index->header.size == st.st_size) && (index->header.mtime == index_mtime(&st))) {
+        fclose(in);
+        return 0;
+    }
+
+    // TODO: keep blocks of an appended target, only its last block may have changed
+    long offset = 0;
+    unsigned long headHash;
+    unsigned long tailHash;
+    if ((index->header.numberOfBlocks > 0) && (index->header.size < st.st_size) &&
+        (index_fingerprint(in, index->header.size, &headHash, &tailHash) == 0) &&
+        (headHash == index->header.headHash) && (tailHash == index->header.tailHash)) {
+        index->header.numberOfBlocks--;
+        offset = index->blocks[index->header.numberOfBlocks].offset;
+    }
+    else {
+        index->header.numberOfBlocks = 0;
+    }
+    memcpy(index->header.magic, INDEX_MAGIC, 8);
+    index->header.blockLines = blockLines;
+    index->header.mtime = index_mtime(&st);
+    int status = index_build(index, in, offset);
+    fclose(in);
+    return (status == -1) ? -1 : 1;
+}
+
+/**
+ * @brief index_save
+ *
+ * @param index: index to write to its sidecar
+ *
+ * Sidecar is written to a temporary file first and renamed, so jobs sharing a target never read
+ * a half written index. A target in a read-only directory is just left without sidecar.
+ */
+void index_save(Index* index) {
+    char tempName[INDEX_PATH_SIZE + 16];
+    snprintf(tempName, sizeof(tempName), "%s.%d", index->path, getpid());
+    FILE* out = fopen(tempName, "w");
+    if (out == NULL) {
+        return;
+    }
+    int written = (fwrite(&index->header, sizeof(IndexHeader), 1, out) == 1) &&
+                  (fwrite(index->blocks, sizeof(IndexBlock), index->header.numberOfBlocks, out) ==
+                   (size_t)index->header.numberOfBlocks);
+    if ((fclose(out) != 0) || !written || (rename(tempName, index->path) == -1)) {
+        unlink(tempName);
+    }
+}
+
+void index_free(Index* index) {
+    free(index->blocks);
+    index->blocks = NULL;
+    index->capacity = 0;
+}
+
+static int index_match(const char* line, const char* word, long from, long to) {
+    // whole word match like 'grep -wF', and leading timestamp within [from, to]
+    if ((from != LONG_MIN) || (to != LONG_MAX)) {
+        long time = index_timestamp(line);
+        if ((time == -1) || (time < from) || (time > to)) {
+            return 0;
+        }
+    }
+    size_t length = strlen(word);
+    if (length == 0) {
+        return 1;
+    }
+    for (const char* p = strstr(line, word); p != NULL; p = strstr(p + 1, word)) {
+        if (((p == line) || !index_is_word(p[-1])) && !index_is_word(p[length])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static long index_scan(FILE* in, long start, long end, const char* word, long from, long to) {
+    // print matching lines in [start, end), end -1 for end of file
+    if (fseeko(in, start, SEEK_SET) == -1) {
+        return 0;
+    }
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    long matches = 0;
+    long offset = start;
+    while (((end == -1) || (offset < end)) && ((length = getline(&line, &capacity, in)) != -1)) {
+        offset += length;
+        if (index_match(line, word, from, to)) {
+            fputs(line, stdout);
+            if (line[length - 1] != '\n') {
+                putchar('\n');
+            }
+            matches++;
+        }
+    }
+    free(line);
+    return matches;
+}
+
+/**
+ * @brief index_grep
+ *
+ * @param argc: number of arguments
+ * @param argv: {"mgrep", [-f from] [-t to] [-S], word, file}
+ * @param blockLines: lines per block of sidecar, 0 to scan without sidecar
+ * @return int: exit status like grep, 0 if a line matches, 1 if none, 2 on error
+ *
+ * Built-in grep printing lines of file that contain word as a whole word, optionally only lines
+ * stamped within [from, to]. It builds or refreshes sidecar of file, then scans only blocks whose
+ * bloom filter holds every token of word and whose timestamps overlap the range. '-S' prints
+ * number of blocks scanned to stderr.
+ */
+int index_grep(int argc, char* argv[], int blockLines) {
+    long from = LONG_MIN;
+    long to = LONG_MAX;
+    int statistics = 0;
+    int i = 1;
+    for (; (i < argc - 2) && (argv[i][0] == '-'); i++) {
+        if (strcmp(argv[i], "-S") == 0) {
+            statistics = 1;
+        }
+        else if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc - 2)) {
+            from = index_timestamp(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc - 2)) {
+            to = index_timestamp(argv[++i]);
+        }
+        else {
+            break;
+        }
+    }
+    if ((i != argc - 2) || (from == -1) || (to == -1)) {
+        fprintf(stderr, "Usage: %s [-f from] [-t to] [-S] word file\n", INDEX_GREP);
+        return 2;
+    }
+    const char* word = argv[argc - 2];
+    const char* file = argv[argc - 1];
+
+    // TODO: hash tokens of word, a line can only match if its block holds all of them
+    unsigned long tokens[INDEX_MAX_TOKENS];
+    int numberOfTokens = 0;
+    for (size_t k = 0; (word[k] != '\0') && (numberOfTokens < INDEX_MAX_TOKENS); ) {
+        if (!index_is_word(word[k])) {
+            k++;
+            continue;
+        }
+        size_t start = k;
+        while (index_is_word(word[k])) {
+            k++;
+        }
+        tokens[numberOfTokens++] = index_hash(word + start, k - start);
+    }
+
+    Index index;
+    int state = -1;
+    if (blockLines > 0) {
+        state = index_load(&index, file, blockLines);
+        if (state == 1) {
+            index_save(&index);
+        }
+    }
+    FILE* in = fopen(file, "r");
+    if (in == NULL) {
+        fprintf(stderr, "%s: %s: %s\n", INDEX_GREP, file, strerror(errno));
+        if (state != -1) {
+            index_free(&index);
+        }
+        return 2;
+    }
+    if (state == -1) {
+        long matches = index_scan(in, 0, -1, word, from, to);
+        fclose(in);
+        return (matches > 0) ? 0 : 1;
+    }
+
+    long matches = 0;
+    int scanned = 0;
+    for (int b = 0; b < index.header.numberOfBlocks; b++) {
+        IndexBlock* block = &index.blocks[b];
+        if (((from != LONG_MIN) || (to != LONG_MAX)) && ((block->maxTime < from) || (block->minTime > to))) {
+            continue;
+        }
+        int candidate = 1;
+        for (int k = 0; candidate && (k < numberOfTokens); k++) {
+            candidate = index_bloom_test(block, tokens[k]);
+        }
+        if (!candidate) {
+            continue;
+        }
+        long end = (b + 1 < index.header.numberOfBlocks) ? index.blocks[b + 1].offset : index.header.size;
+        matches += index_scan(in, block->offset, end, word, from, to);
+        scanned++;
+    }
+    // lines appended after index is built are scanned in full
+    matches += index_scan(in, index.header.size, -1, word, from, to);
+    if (statistics) {
+        fflush(stdout);
+        fprintf(stderr, "%s: scanned %d/%d blocks of %s\n", INDEX_GREP, scanned, index.header.numberOfBlocks, file);
+    }
+    fclose(in);
+    index_free(&index);
+    return (matches > 0) ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#ifndef MASHINDEX_H
+#define MASHINDEX_H
+
+#define INDEX_SUFFIX ".mashidx"
+#define INDEX_MAGIC "MASHIDX2"
+#define INDEX_PATH_SIZE 4096
+#define INDEX_BLOCK_LINES 1024      // default lines per block
+#define INDEX_BLOOM_BITS 32768      // bloom filter bits per block
+#define INDEX_BLOOM_HASHES 3
+#define INDEX_BLOOM_WORDS (INDEX_BLOOM_BITS / 64)
+#define INDEX_HEAD_SIZE 4096        // bytes at start of target checked on append
+#define INDEX_TAIL_SIZE 4096        // bytes before end of indexed region checked on append
+#define INDEX_GREP "mgrep"          // built-in grep, run in place of exec
+
+/**
+ * @brief IndexHeader
+ *
+ * Header of sidecar index '<file>.mashidx'. The index is valid for its target while size and
+ * mtime match. A target that only grew is taken as appended to if its first bytes and bytes before
+ * the old end still hash to 'headHash' and 'tailHash', and only its last block is rebuilt. Edits
+ * elsewhere in a grown target go unnoticed, so the index assumes append-only files.
+ */
+typedef struct {
+    char magic[8];
+    int blockLines;         // lines per block
+    int numberOfBlocks;
+    long size;              // size of target file indexed
+    long mtime;             // mtime of target file in nanoseconds
+    unsigned long headHash; // FNV-1a of first INDEX_HEAD_SIZE bytes indexed
+    unsigned long tailHash; // FNV-1a of last INDEX_TAIL_SIZE bytes indexed
+} IndexHeader;
+
+/**
+ * @brief IndexBlock
+ *
+ * Block of 'blockLines' lines of target file: where it starts, range of leading timestamps of
+ * its lines, and a bloom filter of its word tokens.
+ */
+typedef struct {
+    long offset;            // byte offset of first line, block ends where next one starts
+    long minTime;           // earliest timestamp in seconds since epoch, LONG_MAX if none
+    long maxTime;           // latest timestamp in seconds since epoch, LONG_MIN if none
+    unsigned long bloom[INDEX_BLOOM_WORDS];
+} IndexBlock;
+
+typedef struct {
+    char path[INDEX_PATH_SIZE];
+    IndexHeader header;
+    IndexBlock* blocks;
+    int capacity;
+} Index;
+
+int index_load(Index* index, const char* file, int blockLines);
+void index_save(Index* index);
+void index_free(Index* index);
+long index_timestamp(const char* line);
+int index_grep(int argc, char* argv[], int blockLines);
+
+#endif
@@ -0,0 +1,252 @@
+#include "mashremote.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/**
+ * @brief remote_connect
+ * 
+ * @param address: agent address in form of 'host:port'
+ * @return int: connected socket, -1 on failure
+ */
+int remote_connect(const char* address) {
+    char host[REMOTE_ADDRESS_SIZE];
+    snprintf(host, sizeof(host), "%s", address);
+    char* port = strrchr(host, ':');
+    if (port == NULL) {
+        return -1;
+    }
+    *port++ = '\0';
+
+    struct addrinfo hints;
+    struct addrinfo* result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &result) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo* p = result; p != NULL; p = p->ai_next) {
+        fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+        if (connect(fd, p->ai_addr, p->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd != -1) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+/**
+ * @brief remote_listen
+ * 
+ * @param address: IPv4 address to bind, NULL for loopback only
+ * @param port: TCP port to listen on
+ * @return int: listening socket, -1 on failure
+ */
+int remote_listen(const char* address, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (address == NULL) {
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+    else if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if ((bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) || (listen(fd, REMOTE_BACKLOG) == -1)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief remote_token
+ * 
+ * @return const char*: shared token from environment, NULL if it is unset or empty
+ */
+const char* remote_token() {
+    const char* token = getenv(REMOTE_TOKEN_ENV);
+    if ((token == NULL) || (strlen(token) == 0)) {
+        return NULL;
+    }
+    return token;
+}
+
+/**
+ * @brief remote_token_equal
+ * 
+ * @return int: 1 if tokens are equal, compared in time independent of where they differ
+ */
+int remote_token_equal(const char* expected, const char* received) {
+    size_t expectedSize = strlen(expected);
+    size_t receivedSize = strlen(received);
+    unsigned char diff = (expectedSize != receivedSize);
+    for (size_t i = 0; i < expectedSize; i++) {
+        diff |= expected[i] ^ ((i < receivedSize) ? received[i] : 0);
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief remote_send
+ * 
+ * @return int: 0 if every byte is sent, -1 otherwise
+ */
+int remote_send(int fd, const void* buffer, size_t size) {
+    const char* p = buffer;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if ((n == -1) && (errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief remote_recv
+ * 
+ * @return int: 0 if every byte is received, -1 on error or early end of stream
+ */
+int remote_recv(int fd, void* buffer, size_t size) {
+    char* p = buffer;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if ((n == -1) && (errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+int remote_send_int(int fd, int value) {
+    unsigned int net = htonl((unsigned int)value);
+    return remote_send(fd, &net, sizeof(net));
+}
+
+int remote_recv_int(int fd, int* value) {
+    unsigned int net;
+    if (remote_recv(fd, &net, sizeof(net)) == -1) {
+        return -1;
+    }
+    *value = (int)ntohl(net);
+    return 0;
+}
+
+int remote_send_long(int fd, long value) {
+    unsigned long net = htobe64((unsigned long)value);
+    return remote_send(fd, &net, sizeof(net));
+}
+
+int remote_recv_long(int fd, long* value) {
+    unsigned long net;
+    if (remote_recv(fd, &net, sizeof(net)) == -1) {
+        return -1;
+    }
+    *value = (long)be64toh(net);
+    return 0;
+}
+
+/**
+ * @brief remote_send_string
+ * 
+ * A string is sent in form of {len(s), s}, the same as message pipe of UI process.
+ */
+int remote_send_string(int fd, const char* s) {
+    int len = strlen(s);
+    if (remote_send_int(fd, len) == -1) {
+        return -1;
+    }
+    return remote_send(fd, s, len);
+}
+
+/**
+ * @brief remote_recv_string
+ * 
+ * @param s: received string, allocated with malloc
+ * @return int: 0 on success, -1 on error or if peer announces more than REMOTE_STRING_MAX_SIZE
+ */
+int remote_recv_string(int fd, char** s) {
+    int len;
+    if ((remote_recv_int(fd, &len) == -1) || (len < 0) || (len > REMOTE_STRING_MAX_SIZE)) {
+        return -1;
+    }
+    char* buffer = malloc(len + 1);
+    if (buffer == NULL) {
+        return -1;
+    }
+    if (remote_recv(fd, buffer, len) == -1) {
+        free(buffer);
+        return -1;
+    }
+    buffer[len] = '\0';
+    *s = buffer;
+    return 0;
+}
+
+/**
+ * @brief remote_send_status
+ * 
+ * A status record is sent field by field in network byte order. Job index and pid only mean
+ * something on the agent, so they are not sent.
+ */
+int remote_send_status(int fd, const JobStatus* status) {
+    if ((remote_send_int(fd, status->mashCode) == -1) || (remote_send_int(fd, status->execErrno) == -1) ||
+        (remote_send_int(fd, status->waitStatus) == -1) || (remote_send_int(fd, status->signal) == -1) ||
+        (remote_send_long(fd, status->startTime) == -1) || (remote_send_long(fd, status->endTime) == -1) ||
+        (remote_send_long(fd, status->bytes) == -1) || (remote_send_long(fd, status->lines) == -1)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief remote_recv_status
+ * 
+ * @param status: record to fill, job index and pid are left untouched
+ */
+int remote_recv_status(int fd, JobStatus* status) {
+    if ((remote_recv_int(fd, &status->mashCode) == -1) || (remote_recv_int(fd, &status->execErrno) == -1) ||
+        (remote_recv_int(fd, &status->waitStatus) == -1) || (remote_recv_int(fd, &status->signal) == -1) ||
+        (remote_recv_long(fd, &status->startTime) == -1) || (remote_recv_long(fd, &status->endTime) == -1) ||
+        (remote_recv_long(fd, &status->bytes) == -1) || (remote_recv_long(fd, &status->lines) == -1)) {
+        return -1;
+    }
+    return 0;
+}
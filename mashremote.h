@@ -0,0 +1,30 @@
+#ifndef MASHREMOTE_H
+#define MASHREMOTE_H
+
+#include <stddef.h>
+#include "masherror.h"
+
+#define REMOTE_BACKLOG 64
+#define REMOTE_ADDRESS_SIZE 256
+#define REMOTE_POLL_INTERVAL 100 // ms
+#define REMOTE_STRING_MAX_SIZE 4096 // longest string accepted from peer, a path at most
+#define REMOTE_TOKEN_ENV "MASH_TOKEN" // shared secret of agents and their clients
+#define REMOTE_REQUEST_JOB 1 // run a job: {command, file, order, force}
+#define REMOTE_REQUEST_EXPAND 2 // expand a glob pattern on agent: {pattern}
+
+int remote_connect(const char* address);
+int remote_listen(const char* address, int port);
+const char* remote_token();
+int remote_token_equal(const char* expected, const char* received);
+int remote_send(int fd, const void* buffer, size_t size);
+int remote_recv(int fd, void* buffer, size_t size);
+int remote_send_int(int fd, int value);
+int remote_recv_int(int fd, int* value);
+int remote_send_long(int fd, long value);
+int remote_recv_long(int fd, long* value);
+int remote_send_string(int fd, const char* s);
+int remote_recv_string(int fd, char** s);
+int remote_send_status(int fd, const JobStatus* status);
+int remote_recv_status(int fd, JobStatus* status);
+
+#endif
@@ -0,0 +1,143 @@
+#include "mashtrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+// nullptr if tracing is disabled, every trace call is a no-op then
+static TraceBuffer* trace = NULL;
+static const char* traceName = NULL;
+
+/**
+ * @brief trace_init
+ * 
+ * @param traceFile: file to dump Chrome trace JSON into, NULL to disable tracing
+ * 
+ * Must be called before forking any child, so the buffer is shared by all mash processes.
+ */
+void trace_init(const char* traceFile) {
+    if (traceFile == NULL) {
+        return;
+    }
+    void* buffer = mmap(NULL, sizeof(TraceBuffer), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        printf("Warning: failed to map trace buffer, tracing is disabled.\n");
+        return;
+    }
+    trace = buffer;
+    traceName = traceFile;
+    trace->epoch = 0;
+    trace->epoch = trace_now();
+}
+
+/**
+ * @brief trace_now
+ * 
+ * @return long: microseconds since trace epoch
+ */
+long trace_now() {
+    if (trace == NULL) {
+        return 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000 - trace->epoch;
+}
+
+static void trace_record(const char* name, const char* detail, long start, long duration) {
+    unsigned long seq = __atomic_fetch_add(&trace->next, 1, __ATOMIC_RELAXED);
+    TraceEvent* event = &trace->events[seq % TRACE_CAPACITY];
+    __atomic_store_n(&event->ready, 0, __ATOMIC_RELAXED);
+    event->pid = getpid();
+    event->start = start;
+    event->duration = duration;
+    strncpy(event->name, name, TRACE_NAME_SIZE - 1);
+    event->name[TRACE_NAME_SIZE - 1] = '\0';
+    strncpy(event->detail, (detail == NULL) ? "" : detail, TRACE_DETAIL_SIZE - 1);
+    event->detail[TRACE_DETAIL_SIZE - 1] = '\0';
+    __atomic_store_n(&event->ready, seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief trace_span
+ * 
+ * @param name: name of span
+ * @param detail: extra information, e.g. command, may be NULL
+ * @param start: start time from trace_now(), span ends now
+ */
+void trace_span(const char* name, const char* detail, long start) {
+    if (trace == NULL) {
+        return;
+    }
+    trace_record(name, detail, start, trace_now() - start);
+}
+
+/**
+ * @brief trace_instant
+ * 
+ * @param name: name of event
+ * @param detail: extra information, e.g. command, may be NULL
+ */
+void trace_instant(const char* name, const char* detail) {
+    if (trace == NULL) {
+        return;
+    }
+    trace_record(name, detail, trace_now(), -1);
+}
+
+static void trace_escape(FILE* out, const char* s) {
+    for (; *s != '\0'; s++) {
+        if ((*s == '"') || (*s == '\\')) {
+            fprintf(out, "\\%c", *s);
+        }
+        else if ((unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", *s);
+        }
+        else {
+            fputc(*s, out);
+        }
+    }
+}
+
+/**
+ * @brief trace_dump
+ * 
+ * Write all events kept in ring buffer to trace file in Chrome trace event format, which can be
+ * loaded by chrome://tracing or Perfetto. Called by main process when every child is done.
+ */
+void trace_dump() {
+    if (trace == NULL) {
+        return;
+    }
+    FILE* out = fopen(traceName, "w");
+    if (out == NULL) {
+        printf("Warning: failed to open trace file '%s'.\n", traceName);
+        return;
+    }
+    unsigned long next = __atomic_load_n(&trace->next, __ATOMIC_ACQUIRE);
+    unsigned long first = (next > TRACE_CAPACITY) ? next - TRACE_CAPACITY : 0;
+    int comma = 0;
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (unsigned long seq = first; seq < next; seq++) {
+        TraceEvent* event = &trace->events[seq % TRACE_CAPACITY];
+        if (__atomic_load_n(&event->ready, __ATOMIC_ACQUIRE) != seq + 1) {
+            continue; // overwritten or never completed
+        }
+        fprintf(out, "%s{\"name\":\"", comma ? ",\n" : "");
+        trace_escape(out, event->name);
+        fprintf(out, "\",\"cat\":\"mash\",\"pid\":%d,\"tid\":%d,\"ts\":%ld,", event->pid, event->pid, event->start);
+        if (event->duration >= 0) {
+            fprintf(out, "\"ph\":\"X\",\"dur\":%ld,", event->duration);
+        }
+        else {
+            fprintf(out, "\"ph\":\"i\",\"s\":\"t\",");
+        }
+        fprintf(out, "\"args\":{\"detail\":\"");
+        trace_escape(out, event->detail);
+        fprintf(out, "\"}}");
+        comma = 1;
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+}
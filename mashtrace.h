@@ -0,0 +1,41 @@
+#ifndef MASHTRACE_H
+#define MASHTRACE_H
+
+#define TRACE_CAPACITY 16384
+#define TRACE_NAME_SIZE 24
+#define TRACE_DETAIL_SIZE 96
+
+/**
+ * @brief TraceEvent
+ * 
+ * One slot of trace ring buffer. A span if duration >= 0, an instant event otherwise.
+ */
+typedef struct {
+    unsigned long ready;    // sequence number + 1 of the event written into slot
+    int pid;
+    long start;             // microseconds since trace epoch
+    long duration;          // microseconds, -1 for instant event
+    char name[TRACE_NAME_SIZE];
+    char detail[TRACE_DETAIL_SIZE];
+} TraceEvent;
+
+/**
+ * @brief TraceBuffer
+ * 
+ * Ring buffer mapped as shared memory before any fork, so main process and every child append
+ * events to it. A slot is claimed by an atomic increment of 'next', so writers never lock.
+ * When the ring is full, the oldest events are overwritten.
+ */
+typedef struct {
+    unsigned long next;     // sequence number of next event
+    long epoch;             // CLOCK_MONOTONIC in microseconds when trace started
+    TraceEvent events[TRACE_CAPACITY];
+} TraceBuffer;
+
+void trace_init(const char* traceFile);
+long trace_now();
+void trace_span(const char* name, const char* detail, long start);
+void trace_instant(const char* name, const char* detail);
+void trace_dump();
+
+#endif